@@ -0,0 +1,62 @@
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 8
+
+void init_arena(struct Arena* arena) {
+    arena->blocks = NULL;
+}
+
+static struct ArenaBlock* new_block(size_t capacity) {
+    struct ArenaBlock* block = (struct ArenaBlock*)malloc(sizeof(struct ArenaBlock) + capacity);
+    if (block == NULL) {
+        fprintf(stderr, "[Error] Arena allocation failed. Attempting to allocate %zu bytes\n", capacity);
+        exit(1);
+    }
+    block->used = 0;
+    block->capacity = capacity;
+    return block;
+}
+
+void* arena_alloc(struct Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    struct ArenaBlock* block = arena->blocks;
+    if (block == NULL || block->used + size > block->capacity) {
+        //oversized requests get their own block behind the current one so the
+        //remaining space in the current block is still used
+        if (size > ARENA_BLOCK_SIZE / 4 && block != NULL) {
+            struct ArenaBlock* big = new_block(size);
+            big->next = block->next;
+            block->next = big;
+            big->used = size;
+            return big->data;
+        }
+        block = new_block(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void* result = block->data + block->used;
+    block->used += size;
+    return result;
+}
+
+//old memory is left in the arena - it is reclaimed with everything else in free_arena
+void* arena_grow(struct Arena* arena, void* ptr, size_t new_size, size_t old_size) {
+    void* result = arena_alloc(arena, new_size);
+    if (ptr != NULL && old_size > 0) {
+        memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return result;
+}
+
+void free_arena(struct Arena* arena) {
+    struct ArenaBlock* block = arena->blocks;
+    while (block != NULL) {
+        struct ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
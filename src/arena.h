@@ -0,0 +1,29 @@
+#ifndef CEBRA_ARENA_H
+#define CEBRA_ARENA_H
+
+#include "common.h"
+
+//Bump allocator for AST nodes and types.  Memory comes straight from the system
+//allocator (not realloc_mem), so it is invisible to the GC and is released all at once.
+
+#define ARENA_ALLOCATE(arena, type) ((type*)arena_alloc(arena, sizeof(type)))
+#define ARENA_GROW_ARRAY(arena, ptr, type, new_count, old_count) \
+    ((type*)arena_grow(arena, (void*)ptr, sizeof(type) * new_count, sizeof(type) * old_count))
+
+struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+};
+
+struct Arena {
+    struct ArenaBlock* blocks;
+};
+
+void init_arena(struct Arena* arena);
+void* arena_alloc(struct Arena* arena, size_t size);
+void* arena_grow(struct Arena* arena, void* ptr, size_t new_size, size_t old_size);
+void free_arena(struct Arena* arena);
+
+#endif// CEBRA_ARENA_H
@@ -1,5 +1,6 @@
 #include "ast.h"
-#include "memory.h"
+#include "arena.h"
+#include "compiler.h"
 
 //also init 'has_declarations'
 struct Node* insert_node(struct Node* node) {
@@ -11,8 +12,8 @@ struct Node* insert_node(struct Node* node) {
 }
 
 struct Node* make_node_list() {
-    struct NodeList* nl = ALLOCATE(struct NodeList);
-    nl->nodes = ALLOCATE_ARRAY(struct Node*);
+    struct NodeList* nl = ARENA_ALLOCATE(current_compiler->arena, struct NodeList);
+    nl->nodes = NULL;
     nl->count = 0;
     nl->capacity = 0;
     nl->base.type = NODE_LIST;
@@ -21,7 +22,7 @@ struct Node* make_node_list() {
 }
 
 struct Node* make_sequence(Token op, struct NodeList* left, struct Node* right) {
-    struct Sequence* seq = ALLOCATE(struct Sequence);
+    struct Sequence* seq = ARENA_ALLOCATE(current_compiler->arena, struct Sequence);
     seq->op = op;
     seq->left = left;
     seq->right = right;
@@ -33,7 +34,7 @@ struct Node* make_sequence(Token op, struct NodeList* left, struct Node* right)
 void add_node(struct NodeList* nl, struct Node* node) {
     if (nl->count + 1 > nl->capacity) {
         int new_capacity = nl->capacity == 0 ? 8 : nl->capacity * 2;
-        nl->nodes = GROW_ARRAY(nl->nodes, struct Node*, new_capacity, nl->capacity);
+        nl->nodes = ARENA_GROW_ARRAY(current_compiler->arena, nl->nodes, struct Node*, new_capacity, nl->capacity);
         nl->capacity = new_capacity;
     }
 
@@ -46,7 +47,7 @@ void add_node(struct NodeList* nl, struct Node* node) {
  */
 
 struct Node* make_decl_var(Token name, struct Type* type, struct Node* right) {
-    DeclVar* decl_var = ALLOCATE(DeclVar);
+    DeclVar* decl_var = ARENA_ALLOCATE(current_compiler->arena, DeclVar);
     decl_var->name = name;
     decl_var->type = type;
     decl_var->right = right;
@@ -56,7 +57,7 @@ struct Node* make_decl_var(Token name, struct Type* type, struct Node* right) {
 }
 
 struct Node* make_decl_fun(Token name, struct NodeList* parameters, struct Type* type, struct Node* body, bool anonymous) {
-    DeclFun* df = ALLOCATE(DeclFun);
+    DeclFun* df = ARENA_ALLOCATE(current_compiler->arena, DeclFun);
     df->name = name;
     df->parameters = parameters;
     df->type = type;
@@ -68,7 +69,7 @@ struct Node* make_decl_fun(Token name, struct NodeList* parameters, struct Type*
 }
 
 struct Node* make_decl_struct(Token name, struct Node* super, struct NodeList* decls) {
-    struct DeclStruct* dc = ALLOCATE(struct DeclStruct);
+    struct DeclStruct* dc = ARENA_ALLOCATE(current_compiler->arena, struct DeclStruct);
     dc->name = name;
     dc->super = super;
     dc->decls = decls;
@@ -78,7 +79,7 @@ struct Node* make_decl_struct(Token name, struct Node* super, struct NodeList* d
 }
 
 struct Node* make_decl_enum(Token name, struct NodeList* decls) {
-    struct DeclEnum* de = ALLOCATE(struct DeclEnum);
+    struct DeclEnum* de = ARENA_ALLOCATE(current_compiler->arena, struct DeclEnum);
     de->name = name;
     de->identifier = make_literal(name);
     de->decls = decls;
@@ -88,7 +89,7 @@ struct Node* make_decl_enum(Token name, struct NodeList* decls) {
 }
 
 struct Node* make_decl_container(Token name, struct Type* type) {
-    struct DeclContainer* dc = ALLOCATE(struct DeclContainer);
+    struct DeclContainer* dc = ARENA_ALLOCATE(current_compiler->arena, struct DeclContainer);
     dc->name = name;
     dc->type = type;
     dc->base.type = NODE_CONTAINER;
@@ -101,7 +102,7 @@ struct Node* make_decl_container(Token name, struct Type* type) {
  */
 
 struct Node* make_expr_stmt(struct Node* expr) {
-    ExprStmt* es = ALLOCATE(ExprStmt);
+    ExprStmt* es = ARENA_ALLOCATE(current_compiler->arena, ExprStmt);
     es->expr = expr;
     es->base.type = NODE_EXPR_STMT;
 
@@ -109,7 +110,7 @@ struct Node* make_expr_stmt(struct Node* expr) {
 }
 
 struct Node* make_block(Token name, struct NodeList* dl) {
-    Block* block = ALLOCATE(Block);
+    Block* block = ARENA_ALLOCATE(current_compiler->arena, Block);
     block->name = name;
     block->decl_list = dl;
     block->base.type = NODE_BLOCK;
@@ -119,7 +120,7 @@ struct Node* make_block(Token name, struct NodeList* dl) {
 
 struct Node* make_if_else(Token name, struct Node* condition, 
                           struct Node* then_block, struct Node* else_block) {
-    IfElse* ie = ALLOCATE(IfElse);
+    IfElse* ie = ARENA_ALLOCATE(current_compiler->arena, IfElse);
     ie->name = name;
     ie->condition = condition;
     ie->then_block = then_block;
@@ -130,7 +131,7 @@ struct Node* make_if_else(Token name, struct Node* condition,
 }
 
 struct Node* make_when(Token name, struct NodeList* cases) {
-    struct When* when = ALLOCATE(struct When);
+    struct When* when = ARENA_ALLOCATE(current_compiler->arena, struct When);
     when->name = name;
     when->cases = cases;
     when->base.type = NODE_WHEN;
@@ -140,7 +141,7 @@ struct Node* make_when(Token name, struct NodeList* cases) {
 
 struct Node* make_while(Token name, struct Node* condition, 
                         struct Node* then_block) {
-    While* wh = ALLOCATE(While);
+    While* wh = ARENA_ALLOCATE(current_compiler->arena, While);
     wh->name = name;
     wh->condition = condition;
     wh->then_block = then_block;
@@ -151,7 +152,7 @@ struct Node* make_while(Token name, struct Node* condition,
 
 struct Node* make_for(Token name, struct Node* initializer, struct Node* condition, 
                       struct Node* update, struct Node* then_block) {
-    For* fo = ALLOCATE(For);
+    For* fo = ARENA_ALLOCATE(current_compiler->arena, For);
     fo->name = name;
     fo->initializer = initializer;
     fo->condition = condition;
@@ -162,8 +163,19 @@ struct Node* make_for(Token name, struct Node* initializer, struct Node* conditi
     return insert_node((struct Node*)fo);
 }
 
+struct Node* make_for_each(Token name, struct Node* element, struct Node* iterable, struct Node* then_block) {
+    ForEach* fe = ARENA_ALLOCATE(current_compiler->arena, ForEach);
+    fe->name = name;
+    fe->element = element;
+    fe->iterable = iterable;
+    fe->then_block = then_block;
+    fe->base.type = NODE_FOR_EACH;
+
+    return insert_node((struct Node*)fe);
+}
+
 struct Node* make_return(Token name, struct Node* right) {
-    Return* ret = ALLOCATE(Return);
+    Return* ret = ARENA_ALLOCATE(current_compiler->arena, Return);
     ret->name = name;
     ret->right = right;
     ret->base.type = NODE_RETURN;
@@ -176,7 +188,7 @@ struct Node* make_return(Token name, struct Node* right) {
  */
 
 struct Node* make_literal(Token name) {
-    Literal* literal = ALLOCATE(Literal);
+    Literal* literal = ARENA_ALLOCATE(current_compiler->arena, Literal);
     literal->name = name;
     literal->base.type = NODE_LITERAL;
 
@@ -184,7 +196,7 @@ struct Node* make_literal(Token name) {
 }
 
 struct Node* make_unary(Token name, struct Node* right) {
-    Unary* unary = ALLOCATE(Unary);
+    Unary* unary = ARENA_ALLOCATE(current_compiler->arena, Unary);
     unary->name = name;
     unary->right = right;
     unary->base.type = NODE_UNARY;
@@ -193,7 +205,7 @@ struct Node* make_unary(Token name, struct Node* right) {
 }
 
 struct Node* make_binary(Token name, struct Node* left, struct Node* right) {
-    Binary* binary = ALLOCATE(Binary);
+    Binary* binary = ARENA_ALLOCATE(current_compiler->arena, Binary);
     binary->name = name;
     binary->left = left;
     binary->right = right;
@@ -203,7 +215,7 @@ struct Node* make_binary(Token name, struct Node* left, struct Node* right) {
 }
 
 struct Node* make_logical(Token name, struct Node* left, struct Node* right) {
-    Logical* logical = ALLOCATE(Logical);
+    Logical* logical = ARENA_ALLOCATE(current_compiler->arena, Logical);
     logical->name = name;
     logical->left = left;
     logical->right = right;
@@ -213,7 +225,7 @@ struct Node* make_logical(Token name, struct Node* left, struct Node* right) {
 }
 
 struct Node* make_get_prop(struct Node* inst, Token prop) {
-    GetProp* get_prop = ALLOCATE(GetProp);
+    GetProp* get_prop = ARENA_ALLOCATE(current_compiler->arena, GetProp);
     get_prop->inst = inst;
     get_prop->prop = prop;
     get_prop->base.type = NODE_GET_PROP;
@@ -222,7 +234,7 @@ struct Node* make_get_prop(struct Node* inst, Token prop) {
 }
 
 struct Node* make_set_prop(struct Node* inst, struct Node* right) {
-    SetProp* set_prop = ALLOCATE(SetProp);
+    SetProp* set_prop = ARENA_ALLOCATE(current_compiler->arena, SetProp);
     set_prop->inst = inst;
     set_prop->right = right;
     set_prop->base.type = NODE_SET_PROP;
@@ -231,7 +243,7 @@ struct Node* make_set_prop(struct Node* inst, struct Node* right) {
 }
 
 struct Node* make_get_var(Token name) {
-    GetVar* get_var = ALLOCATE(GetVar);
+    GetVar* get_var = ARENA_ALLOCATE(current_compiler->arena, GetVar);
     get_var->name = name;
     get_var->base.type = NODE_GET_VAR;
 
@@ -239,7 +251,7 @@ struct Node* make_get_var(Token name) {
 }
 
 struct Node* make_set_var(struct Node* left, struct Node* right) {
-    SetVar* set_var = ALLOCATE(SetVar);
+    SetVar* set_var = ARENA_ALLOCATE(current_compiler->arena, SetVar);
     set_var->left = left;
     set_var->right = right;
     set_var->base.type = NODE_SET_VAR;
@@ -249,7 +261,7 @@ struct Node* make_set_var(struct Node* left, struct Node* right) {
 
 
 struct Node* make_slice(Token name, struct Node* left, struct Node* start_idx, struct Node* end_idx) {
-    Slice* ss = ALLOCATE(Slice);
+    Slice* ss = ARENA_ALLOCATE(current_compiler->arena, Slice);
     ss->name = name;
     ss->left = left;
     ss->start_idx = start_idx;
@@ -260,7 +272,7 @@ struct Node* make_slice(Token name, struct Node* left, struct Node* start_idx, s
 }
 
 struct Node* make_get_element(Token name, struct Node* left, struct Node* idx) {
-    GetElement* get_ele = ALLOCATE(GetElement);
+    GetElement* get_ele = ARENA_ALLOCATE(current_compiler->arena, GetElement);
     get_ele->name = name;
     get_ele->left = left;
     get_ele->idx = idx;
@@ -270,7 +282,7 @@ struct Node* make_get_element(Token name, struct Node* left, struct Node* idx) {
 }
 
 struct Node* make_set_element(struct Node* left, struct Node* right) {
-    SetElement* set_ele = ALLOCATE(SetElement);
+    SetElement* set_ele = ARENA_ALLOCATE(current_compiler->arena, SetElement);
     set_ele->left = left;
     set_ele->right = right;
     set_ele->base.type = NODE_SET_ELEMENT;
@@ -279,7 +291,7 @@ struct Node* make_set_element(struct Node* left, struct Node* right) {
 }
 
 struct Node* make_call(Token name, struct Node* left, struct NodeList* arguments) {
-    Call* call = ALLOCATE(Call);
+    Call* call = ARENA_ALLOCATE(current_compiler->arena, Call);
     call->name = name;
     call->left = left;
     call->arguments = arguments;
@@ -289,7 +301,7 @@ struct Node* make_call(Token name, struct Node* left, struct NodeList* arguments
 }
 
 struct Node* make_nil(Token name) {
-    Nil* nil = ALLOCATE(Nil);
+    Nil* nil = ARENA_ALLOCATE(current_compiler->arena, Nil);
     nil->name = name;
     nil->base.type = NODE_NIL;
 
@@ -297,7 +309,7 @@ struct Node* make_nil(Token name) {
 }
 
 struct Node* make_cast(Token name, struct Node* left, struct Type* type) {
-    Cast* cast = ALLOCATE(Cast);
+    Cast* cast = ARENA_ALLOCATE(current_compiler->arena, Cast);
     cast->name = name;
     cast->left = left;
     cast->type = type;
@@ -393,6 +405,10 @@ void print_node(struct Node* node) {
             printf("For");
             break;
         }
+        case NODE_FOR_EACH: {
+            printf("ForEach");
+            break;
+        }
         case NODE_RETURN: {
             //TODO: fill this in
             printf("Return");
@@ -477,153 +493,3 @@ void print_node(struct Node* node) {
     } 
 }
 
-
-void free_node(struct Node* node) {
-    if (node == NULL) return;
-    switch(node->type) {
-        case NODE_LIST: {
-            struct NodeList* nl = (struct NodeList*)node;
-            FREE_ARRAY(nl->nodes, struct Node*, nl->capacity);
-            FREE(nl, struct NodeList);
-            break;
-        }
-        case NODE_SEQUENCE: {
-            struct Sequence* seq = (struct Sequence*)node;
-            FREE(seq, struct Sequence);
-            break;
-        }
-        //Declarations
-        case NODE_DECL_VAR: {
-            DeclVar* decl_var = (DeclVar*)node;
-            FREE(decl_var, DeclVar);
-            break;
-        }
-        case NODE_FUN: {
-            DeclFun* df = (DeclFun*)node;
-            FREE(df, DeclFun);
-            break;
-        }
-        case NODE_STRUCT: {
-            struct DeclStruct* dc = (struct DeclStruct*)node;
-            FREE(dc, struct DeclStruct);
-            break;
-        }
-        case NODE_ENUM: {
-            struct DeclEnum* de = (struct DeclEnum*)node;
-            FREE(de, struct DeclEnum);
-            break;
-        }
-        case NODE_CONTAINER: {
-            struct DeclContainer* de = (struct DeclContainer*)node;
-            FREE(de, struct DeclContainer);
-            break;
-        }
-        //Statements
-        case NODE_EXPR_STMT: {
-            ExprStmt* es = (ExprStmt*)node;
-            FREE(es, ExprStmt);
-            break;
-        }
-        case NODE_BLOCK: {
-            Block* block = (Block*)node;
-            FREE(block, Block);
-            break;
-        }
-        case NODE_IF_ELSE: {
-            IfElse* ie = (IfElse*)node;
-            FREE(ie, IfElse);
-            break;
-        }
-        case NODE_WHEN: {
-            struct When* when = (struct When*)node;
-            FREE(when, struct When);
-            break;
-        }
-        case NODE_WHILE: {
-            While* wh = (While*)node;
-            FREE(wh, While);
-            break;
-        }
-        case NODE_FOR: {
-            For* fo = (For*)node;
-            FREE(fo, For);
-            break;
-        }
-        case NODE_RETURN: {
-            Return* ret = (Return*)node;
-            FREE(ret, Return);
-            break;
-        }
-        //struct Expressions
-        case NODE_LITERAL: {
-            Literal* literal = (Literal*)node;
-            FREE(literal, Literal);
-            break;
-        }
-        case NODE_BINARY: {
-            Binary* binary = (Binary*)node;
-            FREE(binary, Binary);
-            break;
-        }
-        case NODE_LOGICAL: {
-            Logical* binary = (Logical*)node;
-            FREE(binary, Logical);
-            break;
-        }
-        case NODE_UNARY: {
-            Unary* unary = (Unary*)node;
-            FREE(unary, Unary);
-            break;
-        }
-        case NODE_GET_PROP: {
-            GetProp* get_prop = (GetProp*)node;
-            FREE(get_prop, GetProp);
-            break;
-        }
-        case NODE_SET_PROP: {
-            SetProp* set_prop = (SetProp*)node;
-            FREE(set_prop, SetProp);
-            break;
-        }
-        case NODE_GET_VAR: {
-            GetVar* gv = (GetVar*)node;
-            FREE(gv, GetVar);
-            break;
-        }
-        case NODE_SET_VAR: {
-            SetVar* sv = (SetVar*)node;
-            FREE(sv, SetVar);
-            break;
-        }
-        case NODE_SLICE: {
-            Slice* ss = (Slice*)node;
-            FREE(ss, Slice);
-            break;
-        }
-        case NODE_GET_ELEMENT: {
-            GetElement* gv = (GetElement*)node;
-            FREE(gv, GetElement);
-            break;
-        }
-        case NODE_SET_ELEMENT: {
-            SetElement* sv = (SetElement*)node;
-            FREE(sv, SetElement);
-            break;
-        }
-        case NODE_CALL: {
-            Call* call = (Call*)node;
-            FREE(call, Call);
-            break;
-        }
-        case NODE_NIL: {
-            Nil* nil = (Nil*)node;
-            FREE(nil, Nil);
-            break;
-        }
-        case NODE_CAST: {
-            Cast* cast = (Cast*)node;
-            FREE(cast, Cast);
-            break;
-        }
-    } 
-}
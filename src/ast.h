@@ -24,6 +24,7 @@ typedef enum {
     NODE_IF_ELSE,
     NODE_WHILE,
     NODE_FOR,
+    NODE_FOR_EACH,
     NODE_FUN,
     NODE_RETURN,
     NODE_CALL,
@@ -144,6 +145,14 @@ typedef struct {
     struct Node* then_block;
 } For;
 
+typedef struct {
+    struct Node base;
+    Token name;
+    struct Node* element;
+    struct Node* iterable;
+    struct Node* then_block;
+} ForEach;
+
 typedef struct {
     struct Node base;
     Token name;
@@ -259,6 +268,7 @@ struct Node* make_if_else(Token name, struct Node* condition, struct Node* then_
 struct Node* make_when(Token name, struct NodeList* cases);
 struct Node* make_while(Token name, struct Node* condition, struct Node* then_block);
 struct Node* make_for(Token name, struct Node* initializer, struct Node* condition, struct Node* update, struct Node* then_block);
+struct Node* make_for_each(Token name, struct Node* element, struct Node* iterable, struct Node* then_block);
 struct Node* make_decl_fun(Token name, struct NodeList* parameters, struct Type* type, struct Node* body, bool anonymous);
 struct Node* make_return(Token name, struct Node* right);
 struct Node* make_call(Token name, struct Node* left, struct NodeList* arguments);
@@ -274,6 +284,5 @@ struct Node* make_sequence(Token name, struct NodeList* left, struct Node* right
 struct Node* make_slice(Token name, struct Node* left, struct Node* start_idx, struct Node* end_idx);
 
 void print_node(struct Node* node);
-void free_node(struct Node* node);
 
 #endif// CEBRA_AST_H
@@ -60,8 +60,11 @@ const char* op_to_string(OpCode op) {
         case OP_GET_ELEMENT: return "OP_GET_ELEMENT";
         case OP_SET_ELEMENT: return "OP_SET_ELEMENT";
         case OP_MAP: return "OP_MAP";
+        case OP_SET: return "OP_SET";
+        case OP_IN_SET: return "OP_IN_SET";
         case OP_GET_KEYS: return "OP_GET_KEYS";
         case OP_GET_VALUES: return "OP_GET_VALUES";
+        case OP_NEXT_ENTRY: return "OP_NEXT_ENTRY";
         case OP_CAST: return "OP_CAST";
         case OP_ADD_GLOBAL: return "OP_ADD_GLOBAL";
         case OP_GET_GLOBAL: return "OP_GET_GLOBAL";
@@ -163,6 +166,15 @@ void disassemble_chunk(struct ObjFunction* function) {
                 printf("->[%d]", dis + i);
                 break;
             }
+            case OP_NEXT_ENTRY: {
+                int map_slot = read_byte(chunk, i++);
+                int cursor_slot = read_byte(chunk, i++);
+                i++;
+                uint16_t dis = read_short(chunk, i);
+                i += 2;
+                printf("[%d][%d]->[%d]", map_slot, cursor_slot, dis + i);
+                break;
+            }
             case OP_JUMP_BACK: {
                 uint16_t dis = read_short(chunk, i);
                 i += 2;
@@ -42,8 +42,11 @@ typedef enum {
     OP_SET_ELEMENT,
     OP_IN_LIST,
     OP_MAP,
+    OP_SET,
+    OP_IN_SET,
     OP_GET_KEYS,
     OP_GET_VALUES,
+    OP_NEXT_ENTRY,
     OP_CAST,
     OP_ADD_GLOBAL,
     OP_GET_GLOBAL,
@@ -9,6 +9,34 @@
     #define DIR_SEPARATOR '/'
 #endif
 
+//dead objects are freed on a separate sweeper thread (requires pthreads)
+#if !defined(_WIN32)
+    #define BACKGROUND_SWEEP
+#endif
+
+//large matrix multiplications are split across threads (requires pthreads)
+#if !defined(_WIN32)
+    #define THREADED_MATMUL
+#endif
+
+//mmap() maps files into memory (requires POSIX), otherwise the file is read into a buffer
+#if !defined(_WIN32)
+    #define MMAP_FILES
+#endif
+
+//parallel_map and parallel_reduce run on worker threads (requires pthreads), otherwise
+//the workers run one after another on the calling thread
+#if !defined(_WIN32)
+    #define PARALLEL_WORKERS
+#endif
+
+//each thread running a VM has its own heap (see memory.h)
+#ifdef _MSC_VER
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
 
 #define _CRT_SECURE_NO_WARNINGS //to disable warning about using fopen
 #include <stdio.h>
@@ -91,6 +91,44 @@ static void emit_jump_by(struct Compiler* compiler, OpCode op, int index) {
 }
 
 
+//The char the escape sequence '\c' stands for, or '\0' if there isn't one (the sequence is dropped)
+static char escaped_char(char c) {
+    switch (c) {
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'v': return '\v';
+        case '\\': return '\\';
+        case '\'': return '\'';
+        case '\"': return '\"';
+        case '?': return '?';
+        default: return '\0';
+    }
+}
+
+//Escape sequences in string literals are decoded once here, so strings hold the chars themselves
+static struct ObjString* make_string_literal(const char* start, int length) {
+    if (memchr(start, '\\', length) == NULL) return make_string(start, length);
+
+    char* chars = GROW_ARRAY(NULL, char, length, 0);
+    int count = 0;
+    for (int i = 0; i < length; i++) {
+        if (start[i] != '\\' || i + 1 == length) {
+            chars[count++] = start[i];
+            continue;
+        }
+        char c = escaped_char(start[++i]);
+        if (c != '\0') chars[count++] = c;
+    }
+
+    struct ObjString* str = make_string(chars, count);
+    FREE_ARRAY(chars, char, length);
+    return str;
+}
+
 static ResultCode compile_literal(struct Compiler* compiler, struct Node* node, struct Type** node_type) {
     ResultCode result = RESULT_SUCCESS;
     Literal* literal = (Literal*)node;
@@ -110,7 +148,7 @@ static ResultCode compile_literal(struct Compiler* compiler, struct Node* node,
             break;
         }
         case TOKEN_STRING: {
-            struct ObjString* str = make_string(literal->name.start, literal->name.length);
+            struct ObjString* str = make_string_literal(literal->name.start, literal->name.length);
             push_root(to_string(str));
             emit_byte(compiler, OP_CONSTANT);
             emit_short(compiler, add_constant(compiler, to_string(str)));
@@ -203,12 +241,19 @@ static ResultCode compile_logical(struct Compiler* compiler, struct Node* node,
         struct Type* list_type = NULL;
         COMPILE_NODE(logical->right, &list_type);
 
-        EMIT_ERROR_IF(list_type != NULL && list_type->type != TYPE_LIST, logical->name, "Identifier after 'in' must reference a List.");
+        //Sets are probed by hash, Lists are scanned
+        if (list_type != NULL && list_type->type == TYPE_SET) {
+            EMIT_ERROR_IF(element_type != NULL && !same_type(element_type, ((struct TypeSet*)list_type)->type), 
+                          logical->name, "Type left of 'in' must match Set element type.");
+            emit_byte(compiler, OP_IN_SET);
+        } else {
+            EMIT_ERROR_IF(list_type != NULL && list_type->type != TYPE_LIST, logical->name, "Identifier after 'in' must reference a List or Set.");
 
-        EMIT_ERROR_IF(list_type != NULL && element_type != NULL && !same_type(element_type, ((struct TypeList*)list_type)->type), 
-                      logical->name, "Type left of 'in' must match List element type.");
+            EMIT_ERROR_IF(list_type != NULL && element_type != NULL && !same_type(element_type, ((struct TypeList*)list_type)->type), 
+                          logical->name, "Type left of 'in' must match List element type.");
 
-        emit_byte(compiler, OP_IN_LIST);
+            emit_byte(compiler, OP_IN_LIST);
+        }
     } else {
         struct Type* left_type = NULL;
         COMPILE_NODE(logical->left, &left_type);
@@ -249,6 +294,119 @@ static ResultCode compile_logical(struct Compiler* compiler, struct Node* node,
     return result;
 }
 
+//Set elements and Map keys are hashed and compared by value
+static bool is_hashable(struct Type* type) {
+    if (type == NULL || type->opt != NULL) return false;
+    return type->type == TYPE_INT || type->type == TYPE_BYTE || type->type == TYPE_STRING || type->type == TYPE_ENUM;
+}
+
+//exact match - a 'nil' key can't be looked up
+static bool is_map_key(struct Type* map_type, struct Type* key_type) {
+    struct Type* expected = ((struct TypeMap*)map_type)->key_type;
+    return key_type->type == expected->type && same_type(expected, key_type);
+}
+
+//Lists of ints, floats and bytes are stored unboxed by the vm
+static ListKind list_kind(struct Type* list_type) {
+    struct Type* element_type = ((struct TypeList*)list_type)->type;
+    if (element_type == NULL || element_type->opt != NULL) return LIST_BOXED;
+    switch (element_type->type) {
+        case TYPE_INT: return LIST_INT;
+        case TYPE_FLOAT: return LIST_FLOAT;
+        case TYPE_BYTE: return LIST_BYTE;
+        default: return LIST_BOXED;
+    }
+}
+
+//Natives can't declare generic signatures, so parallel_map and parallel_reduce take 'nil' (any
+//type) for their function and init parameters and return TYPE_INFER (in a List for parallel_map).
+//TYPE_INFER stands for the type returned by the function argument.
+static bool returns_inferred_type(struct TypeFun* type_fun) {
+    if (type_fun->returns->count != 1) return false;
+    struct Type* type = type_fun->returns->types[0];
+    if (type->type == TYPE_LIST) type = ((struct TypeList*)type)->type;
+    return type != NULL && type->type == TYPE_INFER;
+}
+
+//The parameters of the function argument must take the elements of the List argument, and any
+//other 'nil' parameter must take what the function returns.  A function that takes two elements
+//is folded over the List, so it must also return the element type.
+static ResultCode infer_return_type(struct Compiler* compiler, Call* call, struct TypeFun* type_fun, struct Type** arg_types, struct Type** node_type) {
+    ResultCode result = RESULT_SUCCESS;
+    struct Type* element_type = NULL;
+    struct TypeFun* fun = NULL;
+    int fun_idx = -1;
+    for (int i = 0; i < call->arguments->count; i++) {
+        //already reported
+        if (arg_types[i] == NULL) return RESULT_FAILED;
+        if (arg_types[i]->type == TYPE_LIST && element_type == NULL) {
+            element_type = ((struct TypeList*)arg_types[i])->type;
+        } else if (arg_types[i]->type == TYPE_FUN && fun == NULL) {
+            fun = (struct TypeFun*)arg_types[i];
+            fun_idx = i;
+        }
+    }
+
+    if (element_type == NULL || fun == NULL || fun->returns->count != 1) {
+        add_error(compiler, call->name, "Expected a List and a function returning a single value.");
+        return RESULT_FAILED;
+    }
+
+    struct Type* fun_return = fun->returns->types[0];
+    for (int i = 0; i < fun->params->count; i++) {
+        EMIT_ERROR_IF(!same_type(fun->params->types[i], element_type), call->name, "Function parameters must match the List element type.");
+    }
+    EMIT_ERROR_IF(fun->params->count > 1 && !same_type(fun_return, element_type), call->name, "Function must return the List element type.");
+
+    for (int i = 0; i < call->arguments->count; i++) {
+        if (i == fun_idx || type_fun->params->types[i]->type != TYPE_NIL) continue;
+        EMIT_ERROR_IF(!same_type(arg_types[i], fun_return), call->name, "Argument type must match the function return type.");
+    }
+
+    struct Type* type = type_fun->returns->types[0];
+    *node_type = type->type == TYPE_LIST ? make_list_type(fun_return) : fun_return;
+    return result;
+}
+
+//The Set natives take a Set<nil> and then 'nil' elements or other Set<nil>s.  The elements must
+//be of the first Set's element type (or key type, when remove_key is given a Map) and the other Sets
+//the same type as the first, and a Set<TYPE_INFER> return is also that type.
+static bool takes_set(struct TypeFun* type_fun) {
+    if (type_fun->params->count == 0) return false;
+    struct Type* type = type_fun->params->types[0];
+    return type->type == TYPE_SET && ((struct TypeSet*)type)->type->type == TYPE_NIL;
+}
+
+static ResultCode check_set_arguments(struct Compiler* compiler, Call* call, struct TypeFun* type_fun, struct Type** arg_types, struct Type** node_type) {
+    ResultCode result = RESULT_SUCCESS;
+    //already reported
+    for (int i = 0; i < call->arguments->count; i++) {
+        if (arg_types[i] == NULL) return RESULT_FAILED;
+    }
+
+    struct Type* set_type = arg_types[0];
+    struct Type* element_type = NULL;
+    if (set_type->type == TYPE_SET) {
+        element_type = ((struct TypeSet*)set_type)->type;
+    } else if (set_type->type == TYPE_MAP) {
+        element_type = ((struct TypeMap*)set_type)->key_type;
+    } else {
+        add_error(compiler, call->name, "Expected a Set.");
+        return RESULT_FAILED;
+    }
+    for (int i = 1; i < call->arguments->count; i++) {
+        if (type_fun->params->types[i]->type == TYPE_SET) {
+            EMIT_ERROR_IF(!same_type(arg_types[i], set_type), call->name, "Set types must match.");
+        } else {
+            EMIT_ERROR_IF(!same_type(arg_types[i], element_type), call->name, "Argument type must match the Set element type.");
+        }
+    }
+
+    struct Type* type = type_fun->returns->types[0];
+    *node_type = type->type == TYPE_SET ? set_type : type;
+    return result;
+}
+
 static ResultCode compile_binary(struct Compiler* compiler, struct Node* node, struct Type** node_type) {
     ResultCode result = RESULT_SUCCESS;
     Binary* binary = (Binary*)node;
@@ -293,6 +451,7 @@ static ResultCode compile_binary(struct Compiler* compiler, struct Node* node, s
             emit_byte(compiler, 0);
             emit_byte(compiler, 1);
         }
+        emit_byte(compiler, list_kind(*node_type));
     } else {
         EMIT_ERROR_IF(type1 != NULL && type2 != NULL && !same_type(type1, type2), binary->name, "Left and right types must match.");
 
@@ -479,6 +638,10 @@ static ResultCode compile_decl_var_and_get_type(struct Compiler* compiler, DeclV
             } else if (dv->type->type == TYPE_MAP) {
                 struct TypeMap* tm = (struct TypeMap*)(dv->type);
                 EMIT_ERROR_IF(tm->type->type == TYPE_NIL, dv->name, "Map value type cannot be 'nil'.");
+                EMIT_ERROR_IF(!is_hashable(tm->key_type), dv->name, "Map key type must be int, byte, string or an enum.");
+            } else if (dv->type->type == TYPE_SET) {
+                struct TypeSet* ts = (struct TypeSet*)(dv->type);
+                EMIT_ERROR_IF(!is_hashable(ts->type), dv->name, "Set element type must be int, byte, string or an enum.");
             }
 
             EMIT_ERROR_IF(type != NULL && !same_type(dv->type, type), dv->name,
@@ -525,7 +688,7 @@ static ResultCode compile_set_element(struct Compiler* compiler, Token name, str
         struct Type* element_type = ((struct TypeList*)left_type)->type;
         EMIT_ERROR_IF(!same_type(element_type, right_type), name, "List type and right side type must match.");
     } else if (left_type->type == TYPE_MAP) {
-        EMIT_ERROR_IF(idx_type->type != TYPE_STRING, name, "Key must be string type.");
+        EMIT_ERROR_IF(!is_map_key(left_type, idx_type), name, "Key type must match Map key type.");
         struct Type* element_type = ((struct TypeMap*)left_type)->type;
         EMIT_ERROR_IF(!same_type(element_type, right_type), name, "Map type and right side type must match.");
     }
@@ -560,6 +723,83 @@ static ResultCode compile_set_prop(struct Compiler* compiler, Token prop, struct
     return result;
 }
 
+//Emits the property access 'gp' with the instance already on the stack
+static ResultCode compile_prop(struct Compiler* compiler, GetProp* gp, struct Type* type_inst, struct Type** node_type) {
+    ResultCode result = RESULT_SUCCESS;
+
+    if (type_inst == NULL) {
+        EMIT_ERROR_IF(type_inst == NULL, gp->prop, "Trying to access property from invalid object.");
+    } else if (type_inst->type == TYPE_LIST) {
+        EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on Lists.");
+        emit_byte(compiler, OP_GET_SIZE);
+        *node_type = make_int_type();
+    } else if (type_inst->type == TYPE_DECL) {
+        struct TypeDecl* td = (struct TypeDecl*)type_inst;
+        //should be ObjEnum on the stack at this point
+        //Enums are a special case of properties
+        if (td->custom_type->type == TYPE_ENUM) {
+            struct TypeEnum* te = (struct TypeEnum*)(td->custom_type);
+            emit_byte(compiler, OP_GET_PROP);
+            struct ObjString* name = make_string(gp->prop.start, gp->prop.length);
+            push_root(to_string(name));
+            emit_short(compiler, add_constant(compiler, to_string(name))); 
+            pop_root();
+
+            Value type_val;
+            EMIT_ERROR_IF(!get_entry(&te->props, name, &type_val), gp->prop, "Constant doesn't exist in enum.");
+
+            *node_type = (struct Type*)te;
+        } else {
+            EMIT_ERROR_IF(true, gp->prop, "Can only use dot notation to select elements in enumerations.");
+        }
+    } else if (type_inst->type == TYPE_STRING) {
+        EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on strings.");
+        emit_byte(compiler, OP_GET_SIZE);
+        *node_type = make_int_type();
+    } else if (type_inst->type == TYPE_MAP) {
+        if (same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "keys", 4))) {
+            emit_byte(compiler, OP_GET_KEYS);
+            *node_type = make_list_type(((struct TypeMap*)type_inst)->key_type);
+            emit_byte(compiler, list_kind(*node_type));
+        } else if (same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "values", 6))) {
+            emit_byte(compiler, OP_GET_VALUES);
+            *node_type = make_list_type(((struct TypeMap*)type_inst)->type);
+            emit_byte(compiler, list_kind(*node_type));
+        } else {
+            EMIT_ERROR_IF(true, gp->prop, "Property doesn't exist on Map.");
+        }
+    } else if (type_inst->type == TYPE_SET) {
+        EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on Sets.");
+        emit_byte(compiler, OP_GET_SIZE);
+        *node_type = make_int_type();
+    } else if (type_inst->type == TYPE_BYTES) {
+        EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on Bytes.");
+        emit_byte(compiler, OP_GET_SIZE);
+        *node_type = make_int_type();
+    } else if (type_inst->type == TYPE_STRUCT) {
+        emit_byte(compiler, OP_GET_PROP);
+        struct ObjString* name = make_string(gp->prop.start, gp->prop.length);
+        push_root(to_string(name));
+        emit_short(compiler, add_constant(compiler, to_string(name))); 
+        pop_root();
+
+        Value type_val = to_nil();
+        struct Type* current = type_inst;
+        while (current != NULL) {
+            struct TypeStruct* tc = (struct TypeStruct*)current;
+            if (get_entry(&tc->props, name, &type_val)) break;
+            current = tc->super;
+        }
+
+        EMIT_ERROR_IF(current == NULL, gp->prop, "Property not found on object.");
+        *node_type = type_val.as.type_type;
+    } else {
+        EMIT_ERROR_IF(true, gp->prop, "Object does not have properties that can be accessed.");
+    }
+
+    return result;
+}
+
 static ResultCode compile_node(struct Compiler* compiler, struct Node* node, struct Type** node_type) {
     ResultCode result = RESULT_SUCCESS;
     if (node == NULL) {
@@ -623,11 +863,15 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
                     right_seq_type = (struct Type*)ta;
                 }
 
-                if (right_seq_type != NULL) {
+                struct TypeArray* right_types = (struct TypeArray*)right_seq_type;
+                if (right_seq_type != NULL && right_types->count != seq->left->count) {
+                    //a right hand side that failed to compile has already been reported
+                    EMIT_ERROR_IF(result != RESULT_FAILED, seq->op, "All variable types and their assignment types must match.");
+                } else if (right_seq_type != NULL) {
                     //update types for variable declarations here using compiled right hand side
                     for (int i = 0; i < decl_idx_count; i++) {
                         if (decl_idx[i] != -1) {
-                            compiler->locals[decl_idx[i]].type = ((struct TypeArray*)right_seq_type)->types[i];
+                            compiler->locals[decl_idx[i]].type = right_types->types[i];
                         }
                     }
 
@@ -646,7 +890,7 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
                                 COMPILE_NODE(ge->idx, &idx_type);
 
                                 int depth = seq->left->count - 1 - i;
-                                struct Type* right_type = ((struct TypeArray*)right_seq_type)->types[i];
+                                struct Type* right_type = right_types->types[i];
                                 
                                 if (left_type != NULL && idx_type != NULL) {
                                     if (compile_set_element(compiler, ge->name, left_type, idx_type, right_type, depth) == RESULT_FAILED)
@@ -662,7 +906,7 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
                                 struct Type* type_inst = NULL;
                                 COMPILE_NODE(gp->inst, &type_inst);
 
-                                struct Type* right_type = ((struct TypeArray*)right_seq_type)->types[i];
+                                struct Type* right_type = right_types->types[i];
                                 int depth = seq->left->count - 1 - i;
 
                                 if (type_inst != NULL) {
@@ -1042,6 +1286,110 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
             *node_type = make_nil_type();
             break;
         }
+        case NODE_FOR_EACH: {
+            ForEach* fe = (ForEach*)node;
+            DeclVar* element = (DeclVar*)fe->element;
+            start_scope(compiler);
+
+            //the iterable is evaluated once and kept in a hidden local, with the index of the next
+            //element (or map entry) in another.  'm.keys' and 'm.values' keep the map itself so that
+            //its entries can be walked in place instead of being copied into a list, and Sets are
+            //walked the same way
+            struct Type* iter_type = NULL;
+            bool over_map = false;
+            bool map_values = false;
+            if (fe->iterable->type == NODE_GET_PROP) {
+                GetProp* gp = (GetProp*)fe->iterable;
+                COMPILE_NODE(gp->inst, &iter_type);
+                over_map = iter_type != NULL && iter_type->type == TYPE_MAP &&
+                           (same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "keys", 4)) ||
+                            same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "values", 6)));
+                if (over_map) {
+                    map_values = gp->prop.length == 6;
+                } else if (compile_prop(compiler, gp, iter_type, &iter_type) == RESULT_FAILED) {
+                    result = RESULT_FAILED;
+                }
+            } else {
+                COMPILE_NODE(fe->iterable, &iter_type);
+                over_map = iter_type != NULL && iter_type->type == TYPE_SET;
+            }
+
+            struct Type* element_type = NULL;
+            if (over_map && iter_type->type == TYPE_SET) {
+                element_type = ((struct TypeSet*)iter_type)->type;
+            } else if (over_map) {
+                struct TypeMap* tm = (struct TypeMap*)iter_type;
+                element_type = map_values ? tm->type : tm->key_type;
+            } else if (iter_type != NULL && iter_type->type == TYPE_LIST) {
+                element_type = ((struct TypeList*)iter_type)->type;
+            } else if (iter_type != NULL && iter_type->type == TYPE_STRING) {
+                element_type = iter_type;
+            } else if (iter_type != NULL && iter_type->type == TYPE_BYTES) {
+                element_type = make_byte_type();
+            } else {
+                EMIT_ERROR_IF(true, fe->name, "Can only use 'foreach' on Lists, Sets, strings, Bytes and Map keys or values.");
+            }
+
+            int iter_slot = add_local(compiler, make_token(TOKEN_IDENTIFIER, -1, "_iter_", 6), iter_type);
+            emit_byte(compiler, OP_CONSTANT);
+            emit_short(compiler, add_constant(compiler, to_integer(0)));
+            int idx_slot = add_local(compiler, make_token(TOKEN_IDENTIFIER, -1, "_idx_", 5), make_int_type());
+
+            int loop_start = compiler->function->chunk.count;
+            int exit_jump;
+            if (over_map) {
+                //pushes the next key (or value) and moves the cursor past it, or jumps out of the loop
+                emit_byte(compiler, OP_NEXT_ENTRY);
+                emit_byte(compiler, iter_slot);
+                emit_byte(compiler, idx_slot);
+                emit_byte(compiler, map_values);
+                emit_byte(compiler, 0xff);
+                emit_byte(compiler, 0xff);
+                exit_jump = compiler->function->chunk.count;
+            } else {
+                emit_byte(compiler, OP_GET_LOCAL);
+                emit_byte(compiler, idx_slot);
+                emit_byte(compiler, OP_GET_LOCAL);
+                emit_byte(compiler, iter_slot);
+                emit_byte(compiler, OP_GET_SIZE);
+                emit_byte(compiler, OP_LESS);
+                exit_jump = emit_jump(compiler, OP_JUMP_IF_FALSE);
+                emit_byte(compiler, OP_POP);
+
+                emit_byte(compiler, OP_GET_LOCAL);
+                emit_byte(compiler, iter_slot);
+                emit_byte(compiler, OP_GET_LOCAL);
+                emit_byte(compiler, idx_slot);
+                emit_byte(compiler, OP_GET_ELEMENT);
+
+                emit_byte(compiler, OP_GET_LOCAL);
+                emit_byte(compiler, idx_slot);
+                emit_byte(compiler, OP_CONSTANT);
+                emit_short(compiler, add_constant(compiler, to_integer(1)));
+                emit_byte(compiler, OP_ADD);
+                emit_byte(compiler, OP_SET_LOCAL);
+                emit_byte(compiler, idx_slot);
+                emit_byte(compiler, 0);
+                emit_byte(compiler, OP_POP);
+            }
+
+            //the element is declared in a scope of its own that ends with each iteration
+            start_scope(compiler);
+            EMIT_ERROR_IF(element_type != NULL && !same_type(element->type, element_type), element->name,
+                          "Declaration type and right hand side type must match.");
+            add_local(compiler, element->name, element->type);
+            struct Type* then_type;
+            COMPILE_NODE(fe->then_block, &then_type);
+            end_scope(compiler);
+            emit_jump_by(compiler, OP_JUMP_BACK, compiler->function->chunk.count + 3 - loop_start);
+
+            patch_jump(compiler, exit_jump);
+            if (!over_map) emit_byte(compiler, OP_POP); //pop condition if false
+
+            end_scope(compiler);
+            *node_type = make_nil_type();
+            break;
+        }
         case NODE_RETURN: {
             Return* ret = (Return*)node;
             struct Type* type = NULL;
@@ -1074,67 +1422,7 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
             GetProp* gp = (GetProp*)node;
             struct Type* type_inst = NULL;
             COMPILE_NODE(gp->inst, &type_inst);
-
-            if (type_inst == NULL) {
-                EMIT_ERROR_IF(type_inst == NULL, gp->prop, "Trying to access property from invalid object.");
-            } else if (type_inst->type == TYPE_LIST) {
-                EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on Lists.");
-                emit_byte(compiler, OP_GET_SIZE);
-                *node_type = make_int_type();
-            } else if (type_inst->type == TYPE_DECL) {
-                struct TypeDecl* td = (struct TypeDecl*)type_inst;
-                //should be ObjEnum on the stack at this point
-                //Enums are a special case of properties
-                if (td->custom_type->type == TYPE_ENUM) {
-                    struct TypeEnum* te = (struct TypeEnum*)(td->custom_type);
-                    emit_byte(compiler, OP_GET_PROP);
-                    struct ObjString* name = make_string(gp->prop.start, gp->prop.length);
-                    push_root(to_string(name));
-                    emit_short(compiler, add_constant(compiler, to_string(name))); 
-                    pop_root();
-
-                    Value type_val;
-                    EMIT_ERROR_IF(!get_entry(&te->props, name, &type_val), gp->prop, "Constant doesn't exist in enum.");
-
-                    *node_type = (struct Type*)te;
-                } else {
-                    EMIT_ERROR_IF(true, gp->prop, "Can only use dot notation to select elements in enumerations.");
-                }
-            } else if (type_inst->type == TYPE_STRING) {
-                EMIT_ERROR_IF(!same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "size", 4)), gp->prop, "Property doesn't exist on strings.");
-                emit_byte(compiler, OP_GET_SIZE);
-                *node_type = make_int_type();
-            } else if (type_inst->type == TYPE_MAP) {
-                if (same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "keys", 4))) {
-                    emit_byte(compiler, OP_GET_KEYS);
-                    *node_type = make_list_type(make_string_type());
-                } else if (same_token_literal(gp->prop, make_token(TOKEN_DUMMY, 0, "values", 6))) {
-                    emit_byte(compiler, OP_GET_VALUES);
-                    *node_type = make_list_type(((struct TypeMap*)type_inst)->type);
-                } else {
-                    EMIT_ERROR_IF(true, gp->prop, "Property doesn't exist on Map.");
-                }
-            } else if (type_inst->type == TYPE_STRUCT) {
-                emit_byte(compiler, OP_GET_PROP);
-                struct ObjString* name = make_string(gp->prop.start, gp->prop.length);
-                push_root(to_string(name));
-                emit_short(compiler, add_constant(compiler, to_string(name))); 
-                pop_root();
-
-                Value type_val = to_nil();
-                struct Type* current = type_inst;
-                while (current != NULL) {
-                    struct TypeStruct* tc = (struct TypeStruct*)current;
-                    if (get_entry(&tc->props, name, &type_val)) break;
-                    current = tc->super;
-                }
-
-                EMIT_ERROR_IF(current == NULL, gp->prop, "Property not found on object.");
-                *node_type = type_val.as.type_type;
-            } else {
-                EMIT_ERROR_IF(true, gp->prop, "Object does not have properties that can be accessed.");
-            }
-
+            if (compile_prop(compiler, gp, type_inst, node_type) == RESULT_FAILED) result = RESULT_FAILED;
             break;
         }
         case NODE_SET_PROP: {
@@ -1218,8 +1506,8 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
             struct Type* end_idx_type = NULL;
             COMPILE_NODE(ss->end_idx, &end_idx_type);
 
-            EMIT_ERROR_IF(left_type == NULL || (left_type->type != TYPE_STRING && left_type->type != TYPE_LIST), 
-                          ss->name, "Slicing can only be used on strings or Lists.");
+            EMIT_ERROR_IF(left_type == NULL || (left_type->type != TYPE_STRING && left_type->type != TYPE_LIST && left_type->type != TYPE_BYTES), 
+                          ss->name, "Slicing can only be used on strings, Lists or Bytes.");
             EMIT_ERROR_IF(start_idx_type == NULL || start_idx_type->type != TYPE_INT, ss->name, "Start index when slicing must be an integer.");
             EMIT_ERROR_IF(end_idx_type == NULL || end_idx_type->type != TYPE_INT, ss->name, "End index when slicing must be an integer.");
 
@@ -1246,11 +1534,16 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
 
                 emit_byte(compiler, OP_GET_ELEMENT);
                 *node_type = ((struct TypeList*)left_type)->type;
+            } else if (left_type->type == TYPE_BYTES) {
+                EMIT_ERROR_IF(idx_type->type != TYPE_INT && idx_type->type != TYPE_BYTE, get_idx->name, "Index must be integer or byte type.");
+
+                emit_byte(compiler, OP_GET_ELEMENT);
+                *node_type = make_byte_type();
             } else if (left_type->type == TYPE_MAP) {
-                EMIT_ERROR_IF(idx_type->type != TYPE_STRING, get_idx->name, "Key must be string type.");
+                EMIT_ERROR_IF(!is_map_key(left_type, idx_type), get_idx->name, "Key type must match Map key type.");
 
                 emit_byte(compiler, OP_GET_ELEMENT);
-                *node_type = ((struct TypeList*)left_type)->type;
+                *node_type = ((struct TypeMap*)left_type)->type;
             } else {
                 EMIT_ERROR_IF(true, get_idx->name, "[] access must be used on a list or map type.");
             }
@@ -1283,10 +1576,18 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
             //for each field in a struct instance
             if (dc->type->type == TYPE_LIST) {
                 emit_byte(compiler, OP_LIST);
+                emit_byte(compiler, list_kind(dc->type));
                 *node_type = dc->type;
             } else if (dc->type->type == TYPE_MAP) {
+                struct Type* key_type = ((struct TypeMap*)(dc->type))->key_type;
+                EMIT_ERROR_IF(!is_hashable(key_type), dc->name, "Map key type must be int, byte, string or an enum.");
                 emit_byte(compiler, OP_MAP);
                 *node_type = dc->type;
+            } else if (dc->type->type == TYPE_SET) {
+                struct Type* element_type = ((struct TypeSet*)(dc->type))->type;
+                EMIT_ERROR_IF(!is_hashable(element_type), dc->name, "Set element type must be int, byte, string or an enum.");
+                emit_byte(compiler, OP_SET);
+                *node_type = dc->type;
             } else {
                 EMIT_ERROR_IF(true, dc->name, "Invalid identifier for container.");
             }
@@ -1315,9 +1616,11 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
                 struct TypeArray* params = (type_fun->params);
 
                 if (call->arguments->count == params->count) {
+                    struct Type* arg_types[UINT8_COUNT];
                     for (int i = 0; i < params->count; i++) {
                         struct Type* arg_type = NULL;
                         COMPILE_NODE(call->arguments->nodes[i], &arg_type);
+                        arg_types[i] = arg_type;
 
                         struct Type* param_type = params->types[i];
 
@@ -1327,8 +1630,15 @@ static ResultCode compile_node(struct Compiler* compiler, struct Node* node, str
                     emit_byte(compiler, OP_CALL);
                     emit_byte(compiler, (uint8_t)(call->arguments->count));
 
-                    if (type_fun->returns->count == 1) *node_type = type_fun->returns->types[0];
-                    else *node_type = (struct Type*)(type_fun->returns);
+                    if (returns_inferred_type(type_fun)) {
+                        if (infer_return_type(compiler, call, type_fun, arg_types, node_type) == RESULT_FAILED) result = RESULT_FAILED;
+                    } else if (takes_set(type_fun)) {
+                        if (check_set_arguments(compiler, call, type_fun, arg_types, node_type) == RESULT_FAILED) result = RESULT_FAILED;
+                    } else if (type_fun->returns->count == 1) {
+                        *node_type = type_fun->returns->types[0];
+                    } else {
+                        *node_type = (struct Type*)(type_fun->returns);
+                    }
 
                 } else {
                     EMIT_ERROR_IF(true, call->name, "Argument count must match function parameter count.");
@@ -1408,6 +1718,16 @@ void init_compiler(struct Compiler* compiler, const char* start, int length, int
     init_table(&compiler->globals);
 
     compiler->enclosing = current_compiler;
+    if (compiler->enclosing != NULL) {
+        compiler->arena = compiler->enclosing->arena;
+    } else {
+        compiler->arena = (struct Arena*)malloc(sizeof(struct Arena));
+        if (compiler->arena == NULL) {
+            fprintf(stderr, "malloc");
+            exit(1);
+        }
+        init_arena(compiler->arena);
+    }
     compiler->return_types = NULL;
     current_compiler = compiler;
 
@@ -1425,12 +1745,12 @@ void free_compiler(struct Compiler* compiler) {
         compiler->types = compiler->types->next;
         free_type(previous);
     }
-    while (compiler->nodes != NULL) {
-        struct Node* previous = compiler->nodes;
-        compiler->nodes = compiler->nodes->next;
-        free_node(previous);
-    }
+    compiler->nodes = NULL;
     free_table(&compiler->globals);
+    if (compiler->enclosing == NULL) {
+        free_arena(compiler->arena);
+        free(compiler->arena);
+    }
     current_compiler = compiler->enclosing;
 }
 
@@ -6,6 +6,7 @@
 #include "chunk.h"
 #include "value.h"
 #include "error.h"
+#include "arena.h"
 
 struct Upvalue {
     int index;
@@ -29,6 +30,7 @@ struct Compiler {
     struct Error* errors;
     int error_count;
     struct Compiler* enclosing;
+    struct Arena* arena; //owned by the outermost compiler and shared by enclosed ones
     struct Type* types;
     struct Node* nodes;
     struct Table globals;
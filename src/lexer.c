@@ -69,6 +69,9 @@ static Token read_keyword(char c) {
             if (match_string("ool")) return new_token(TOKEN_BOOL_TYPE);
             if (match_string("yte")) return new_token(TOKEN_BYTE_TYPE);
             break;
+        case 'B':
+            if (match_string("ytes")) return new_token(TOKEN_BYTES_TYPE);
+            break;
         case 'e':
             if (match_string("lse")) return new_token(TOKEN_ELSE);
             if (match_string("num")) return new_token(TOKEN_ENUM);
@@ -105,9 +108,16 @@ static Token read_keyword(char c) {
             if (match_string("tring")) return new_token(TOKEN_STRING_TYPE);
             if (match_string("truct")) return new_token(TOKEN_STRUCT);
             break;
+        case 'S':
+            if (match_string("tringBuilder")) return new_token(TOKEN_STRING_BUILDER_TYPE);
+            if (match_string("et")) return new_token(TOKEN_SET);
+            break;
         case 't':
             if (match_string("rue")) return new_token(TOKEN_TRUE);
             break;
+        case 'T':
+            if (match_string("ensor")) return new_token(TOKEN_TENSOR_TYPE);
+            break;
         case 'w':
             if (match_string("hile")) return new_token(TOKEN_WHILE);
             if (match_string("hen")) return new_token(TOKEN_WHEN);
@@ -8,10 +8,24 @@
 #include "obj.h"
 #include "native.h"
 
+#if defined(_WIN32)
+    #include <io.h>
+    #define isatty _isatty
+    #define STDOUT_FD 1
+#else
+    #include <unistd.h>
+    #define STDOUT_FD STDOUT_FILENO
+#endif
+
 #define MAX_IMPORTS 256
 #define MAX_SOURCES 1024
 #define MAX_CHARS_PER_LINE 512
 #define MODULE_DIR_PATH "C:\\dev\\cebra\\examples\\interpreter_using_modules\\"
+#define STDOUT_BUFFER_SIZE 65536
+
+//print() writes into this buffer.  It is flushed when it fills, when the program exits and before
+//input() reads, and after every line when stdout is a terminal
+static char stdout_buffer[STDOUT_BUFFER_SIZE];
 
 ResultCode read_file(const char* path, char** source) {
     FILE* file = fopen(path, "rb");
@@ -157,6 +171,7 @@ static ResultCode repl(VM* vm) {
     while(true) {
         ResultCode result = RESULT_SUCCESS;
         printf(">>> ");
+        fflush(stdout);
 
         sources[source_count] = (char*)malloc(MAX_CHARS_PER_LINE); //max chars in line
         if (sources[source_count] == NULL) {
@@ -196,6 +211,8 @@ int main(int argc, char** argv) {
 
     srand(time(NULL));  //only used for 'random_uniform' native function for now
 
+    setvbuf(stdout, stdout_buffer, isatty(STDOUT_FD) ? _IOLBF : _IOFBF, STDOUT_BUFFER_SIZE);
+
     //VM needs memory manager initialized before
     //vm.strings/vm.globals tables can be initialized
     init_memory_manager();
@@ -2,8 +2,97 @@
 #include "memory.h"
 #include "obj.h"
 
+#ifdef BACKGROUND_SWEEP
+#include <pthread.h>
+#endif
+
+
+THREAD_LOCAL MemoryManager mm;
+
+#ifdef BACKGROUND_SWEEP
+//NOTE: sweep() only unlinks dead objects and hands them off here - the sweeper thread
+//does the actual freeing (including fclose) so the mutator can continue right away.
+//Dead objects are unreachable, so the sweeper never touches anything the mutator can see.
+static pthread_t sweeper;
+static pthread_mutex_t sweep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sweep_cond = PTHREAD_COND_INITIALIZER;
+static struct Obj* sweep_queue = NULL;
+static bool sweeper_running = false;
+static int sweeper_bytes_freed = 0;
+//set only on the sweeper itself, so free_mem can check it without taking sweep_lock
+static THREAD_LOCAL bool is_sweeper_thread = false;
+
+static int free_object_chain(struct Obj* obj) {
+    int bytes_freed = 0;
+    while (obj != NULL) {
+        struct Obj* next = obj->next;
+        bytes_freed += free_object(obj);
+        obj = next;
+    }
+    return bytes_freed;
+}
+
+static void* sweeper_thread(void* arg) {
+    (void)arg;
+    is_sweeper_thread = true;
+    pthread_mutex_lock(&sweep_lock);
+    while (true) {
+        while (sweep_queue == NULL && sweeper_running) {
+            pthread_cond_wait(&sweep_cond, &sweep_lock);
+        }
+        if (sweep_queue == NULL) break;
+
+        struct Obj* dead = sweep_queue;
+        sweep_queue = NULL;
+        pthread_mutex_unlock(&sweep_lock);
+        int bytes_freed = free_object_chain(dead);
+        pthread_mutex_lock(&sweep_lock);
+        sweeper_bytes_freed += bytes_freed;
+    }
+    pthread_mutex_unlock(&sweep_lock);
+    return NULL;
+}
+
+static void hand_off_dead_objects(struct Obj* head, struct Obj* tail) {
+    if (head == NULL) return;
+    pthread_mutex_lock(&sweep_lock);
+    tail->next = sweep_queue;
+    sweep_queue = head;
+    pthread_cond_signal(&sweep_cond);
+    pthread_mutex_unlock(&sweep_lock);
+}
 
-MemoryManager mm;
+//bytes freed by the sweeper since the last call are folded back into mm.allocated
+static int reclaim_swept_bytes() {
+    pthread_mutex_lock(&sweep_lock);
+    int bytes_freed = sweeper_bytes_freed;
+    sweeper_bytes_freed = 0;
+    pthread_mutex_unlock(&sweep_lock);
+    mm.allocated -= bytes_freed;
+    return bytes_freed;
+}
+
+static void start_sweeper() {
+    sweeper_running = true;
+    if (pthread_create(&sweeper, NULL, sweeper_thread, NULL) != 0) {
+        fprintf(stderr, "[Error] Failed to start sweeper thread\n");
+        exit(1);
+    }
+}
+
+static void stop_sweeper() {
+    pthread_mutex_lock(&sweep_lock);
+    sweeper_running = false;
+    pthread_cond_signal(&sweep_cond);
+    pthread_mutex_unlock(&sweep_lock);
+    pthread_join(sweeper, NULL);
+
+    //sweeper exits only once the queue is empty, but drain defensively
+    mm.allocated -= free_object_chain(sweep_queue);
+    sweep_queue = NULL;
+    reclaim_swept_bytes();
+}
+#endif
 
 void push_gray(struct Obj* object) {
     if (object == NULL) return;
@@ -57,12 +146,17 @@ void* realloc_mem(void* ptr, size_t new_size, size_t old_size) {
 }
 
 int free_mem(void* ptr, size_t size) {
+#ifdef BACKGROUND_SWEEP
+    //the sweeper reports its total through sweeper_bytes_freed instead of racing on mm.allocated
+    if (!is_sweeper_thread)
+#endif
     mm.allocated -= size;
     free(ptr);
     return size;
 }
 
 void init_memory_manager() {
+    mm.heap = MAIN_HEAP;
     mm.allocated = 0;
     mm.next_gc = 1024 * 1024;
     mm.objects = NULL;
@@ -75,26 +169,58 @@ void init_memory_manager() {
     mm.gray_capacity = 0;
     mm.gray_count = 0;
     mm.vm = NULL;
+#ifdef BACKGROUND_SWEEP
+    start_sweeper();
+#endif
 }
 
 
 void free_memory_manager() {
+#ifdef BACKGROUND_SWEEP
+    stop_sweeper();
+#endif
     free((void*)mm.grays);
 }
 
+//Worker heaps are swept inline and freed all at once when the worker is done,
+//so they don't use the sweeper thread
+void init_worker_memory(uint8_t heap, VM* vm) {
+    mm.heap = heap;
+    mm.allocated = 0;
+    mm.next_gc = 1024 * 1024;
+    mm.objects = NULL;
+    mm.grays = NULL;
+    mm.gray_capacity = 0;
+    mm.gray_count = 0;
+    mm.vm = vm;
+}
+
+void free_worker_memory() {
+    struct Obj* obj = mm.objects;
+    while (obj != NULL) {
+        struct Obj* next = obj->next;
+        free_object(obj);
+        obj = next;
+    }
+    mm.objects = NULL;
+    free((void*)mm.grays);
+    mm.grays = NULL;
+}
+
 void print_memory() {
     printf("bytes allocated: %d\n", mm.allocated);
 }
 
 static void mark_and_push(struct Obj* obj) {
-    if (obj != NULL && !obj->is_marked) {
+    //objects on other heaps are kept alive by their own thread
+    if (obj != NULL && !obj->is_marked && !IS_FOREIGN(obj)) {
         mark_object(obj);
         push_gray(obj);
     }
 }
 
 static void mark_table(struct Table* table) {
-    for (int i = 0; i < table->capacity; i++) {
+    for (int i = 0; i < table->entry_count; i++) {
         struct Entry* entry = &table->entries[i];
         if (entry->key == NULL) continue;
         mark_and_push((struct Obj*)(entry->key));
@@ -103,6 +229,15 @@ static void mark_table(struct Table* table) {
     }
 }
 
+//removed entries have nil keys and values, which aren't objects
+static void mark_value_table(struct ValueTable* table) {
+    for (int i = 0; i < table->entry_count; i++) {
+        struct ValueEntry* entry = &table->entries[i];
+        mark_and_push(get_object(&entry->key));
+        mark_and_push(get_object(&entry->value));
+    }
+}
+
 static void mark_vm_roots() {
     for (Value* slot = mm.vm->stack; slot < mm.vm->stack_top; slot++) {
         struct Obj* obj = get_object(slot);
@@ -120,6 +255,9 @@ static void mark_vm_roots() {
 
     if (mm.vm->initialized) {
         mark_table(&mm.vm->globals);
+        for (int i = 0; i < 256; i++) {
+            mark_and_push((struct Obj*)(mm.vm->single_chars[i]));
+        }
     }
 }
 
@@ -215,13 +353,24 @@ static void trace_references() {
                 break;
             }
             case OBJ_STRING: {
+                struct ObjString* str = (struct ObjString*)obj;
+                //rope halves (or the flat string a rope forwards to)
+                mark_and_push((struct Obj*)(str->left));
+                mark_and_push((struct Obj*)(str->right));
                 break;
             }
             case OBJ_LIST: {
                 struct ObjList* list = (struct ObjList*)obj;
+                //views only reference the elements of the frozen list
+                if (list->frozen != NULL) {
+                    mark_and_push((struct Obj*)(list->frozen));
+                    break;
+                }
+                //packed elements aren't objects
+                if (list->kind != LIST_BOXED) break;
                 //values
-                for (int i = 0; i < list->values.count; i++) {
-                    Value* value = &list->values.values[i];
+                for (int i = 0; i < list->count; i++) {
+                    Value* value = &LIST_VALUES(list)[i];
                     struct Obj* val_obj = get_object(value);
                     mark_and_push(val_obj);
                 }
@@ -233,16 +382,32 @@ static void trace_references() {
             case OBJ_MAP: {
                 struct ObjMap* om = (struct ObjMap*)obj;
                 //table
-                mark_table(&om->table);
+                mark_value_table(&om->table);
+                //views only reference the entries of the frozen map
+                mark_and_push((struct Obj*)(om->frozen));
                 //default value
                 //struct Obj* val_obj = get_object(&om->default_value);
                 //mark_and_push(val_obj);
                 break;
             }
+            case OBJ_SET: {
+                struct ObjSet* set = (struct ObjSet*)obj;
+                mark_value_table(&set->table);
+                break;
+            }
             case OBJ_FILE: {
                 struct ObjFile* of = (struct ObjFile*)obj;
                 mark_and_push((struct Obj*)(of->file_path));
-                mark_and_push((struct Obj*)(of->next_line));
+                break;
+            }
+            case OBJ_BYTES: {
+                struct ObjBytes* bytes = (struct ObjBytes*)obj;
+                mark_and_push((struct Obj*)(bytes->source));
+                break;
+            }
+            case OBJ_TENSOR: {
+                struct ObjTensor* tensor = (struct ObjTensor*)obj;
+                mark_and_push((struct Obj*)(tensor->frozen));
                 break;
             }
             default: {
@@ -256,24 +421,44 @@ static int sweep() {
     struct Obj* previous = NULL;
     struct Obj* current = mm.objects;
     int bytes_freed = 0;
+#ifdef BACKGROUND_SWEEP
+    struct Obj* dead_head = NULL;
+    struct Obj* dead_tail = NULL;
+#endif
     while (current != NULL) {
         if (current->is_marked) {
             current->is_marked = false;
             previous = current;
             current = current->next;
         } else {
+            struct Obj* dead = current;
+            current = current->next;
             if (previous == NULL) {
-                struct Obj* next = current->next;
-                bytes_freed += free_object(current);
-                current = next;
                 mm.objects = current;
             } else {
-                previous->next = current->next;
-                bytes_freed += free_object(current);
-                current = previous->next;
+                previous->next = current;
+            }
+#ifdef BACKGROUND_SWEEP
+            if (mm.heap == MAIN_HEAP) {
+                dead->next = NULL;
+                if (dead_tail == NULL) {
+                    dead_head = dead;
+                } else {
+                    dead_tail->next = dead;
+                }
+                dead_tail = dead;
+                continue;
             }
+#endif
+            bytes_freed += free_object(dead);
         }
     }
+#ifdef BACKGROUND_SWEEP
+    if (mm.heap == MAIN_HEAP) {
+        hand_off_dead_objects(dead_head, dead_tail);
+        bytes_freed = reclaim_swept_bytes();
+    }
+#endif
     return bytes_freed;
 }
 
@@ -300,7 +485,7 @@ static void print_objects() {
 #endif 
 
 static void delete_unmarked_strings() {
-    for (int i = 0; i < mm.vm->strings.capacity; i++) {
+    for (int i = 0; i < mm.vm->strings.entry_count; i++) {
         struct Entry* entry = &mm.vm->strings.entries[i];
         if (entry->key == NULL) continue;
         struct ObjString* s = entry->key;
@@ -318,9 +503,9 @@ void collect_garbage() {
     print_stack(mm.vm); printf("\n");
 #endif 
     mark_vm_roots();
-    mark_compiler_roots();
+    if (mm.heap == MAIN_HEAP) mark_compiler_roots();
     trace_references();
-    if (mm.vm->initialized) {
+    if (mm.vm->initialized && mm.heap == MAIN_HEAP) {
         delete_unmarked_strings();
     }
 #ifdef DEBUG_LOG_GC
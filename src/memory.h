@@ -2,6 +2,7 @@
 #define CEBRA_MEMORY_H
 
 #include <stdlib.h>
+#include "common.h"
 #include "obj.h"
 #include "vm.h"
 
@@ -18,6 +19,8 @@ int free_mem(void* ptr, size_t size);
 
 void init_memory_manager();
 void free_memory_manager();
+void init_worker_memory(uint8_t heap, VM* vm);
+void free_worker_memory();
 void print_memory();
 void collect_garbage();
 
@@ -27,7 +30,13 @@ Value pop_root();
 void push_gray(struct Obj* object);
 struct Obj* pop_gray();
 
+//The main thread allocates on heap 0 (MAIN_HEAP).  Worker threads running parallel_map and
+//parallel_reduce (see parallel.c) each collect their own heap, and can read objects on
+//the main heap (or another worker's heap) but never mark or modify them.
+#define MAIN_HEAP 0
+
 typedef struct {
+    uint8_t heap;
     int allocated;
     int next_gc;
     struct Obj* objects;
@@ -37,6 +46,9 @@ typedef struct {
     int gray_count;
 } MemoryManager;
 
-extern MemoryManager mm;
+extern THREAD_LOCAL MemoryManager mm;
+
+//objects on another thread's heap are read-only
+#define IS_FOREIGN(obj) (((struct Obj*)(obj))->heap != mm.heap)
 
 #endif// CEBRA_MEMORY_H
@@ -5,6 +5,16 @@
 #include <ctype.h>
 #include <math.h>
 
+#include "vector.h"
+#include "parallel.h"
+
+//Natives that modify an argument fail with this when a parallel worker passes them an object
+//from another heap (see parallel.c)
+static ResultCode foreign_argument(void) {
+    native_error = "Parallel workers can't modify objects they didn't make.";
+    return RESULT_FAILED;
+}
+
 static ResultCode exp_native(Value* args, struct ValueArray* returns) {
     double pow;
     if (args[0].type == VAL_INT) {
@@ -24,8 +34,8 @@ static ResultCode exp_native(Value* args, struct ValueArray* returns) {
 
 static ResultCode define_exp(struct Compiler* compiler) {
     struct TypeArray* params = make_type_array();
-    struct Type* f = make_float_type();
-    struct Type* i = make_int_type();
+    struct Type* f = copy_type(make_float_type());
+    struct Type* i = copy_type(make_int_type());
     struct Type* b = make_byte_type();
     f->opt = i;
     i->opt = b;
@@ -95,78 +105,46 @@ static ResultCode define_is_alpha(struct Compiler* compiler) {
 }
 
 
-static ResultCode append_string_with_escape_sequences(FILE* fp, char* s) {
-    char* start = s;
-    char* back_slash = strchr(start, '\\');
-    while (back_slash != NULL) {
-        fprintf(fp, "%.*s", (int)(back_slash-start), start);
-        switch(*(back_slash + 1)) {
-            case 'a': fprintf(fp, "\a"); break;
-            case 'b': fprintf(fp, "\b"); break;
-            case 'f': fprintf(fp, "\f"); break;
-            case 'n': fprintf(fp, "\n"); break;
-            case 'r': fprintf(fp, "\r"); break;
-            case 't': fprintf(fp, "\t"); break;
-            case 'v': fprintf(fp, "\v"); break;
-            case '\\': fprintf(fp, "\\"); break;
-            case '\'': fprintf(fp, "\'"); break;
-            case '\"': fprintf(fp, "\""); break;
-            case '?': fprintf(fp, "\?"); break;
-        }
-        start = back_slash + 2;
-        back_slash = strchr(start, '\\');
+static ResultCode append_native(Value* args, struct ValueArray* returns) {
+    char* chars;
+    int length;
+    if (args[1].type == VAL_STRING_BUILDER) {
+        chars = args[1].as.string_builder_type->chars;
+        length = args[1].as.string_builder_type->length;
+    } else {
+        chars = args[1].as.string_type->chars;
+        length = args[1].as.string_type->length;
     }
 
-    fprintf(fp, "%s", start);
-
-    return RESULT_SUCCESS;
-}
-
-static ResultCode append_native(Value* args, struct ValueArray* returns) {
-    struct ObjFile* file = args[0].as.file_type;
-    struct ObjString* s = args[1].as.string_type;
-    if (fseek(file->fp, 0, SEEK_END) != 0) {
-        fprintf(stderr, "fseek() failed.");
-        exit(1);
+    if (args[0].type == VAL_STRING_BUILDER) {
+        append_to_string_builder(args[0].as.string_builder_type, chars, length);
+        add_value(returns, to_nil()); 
+        return RESULT_SUCCESS;
     }
-    append_string_with_escape_sequences(file->fp, s->chars);
 
-    fflush(file->fp);
-    file->next_line = make_string("", 0);
-    file->is_eof = true;
     add_value(returns, to_nil()); 
+    if (!append_to_file(args[0].as.file_type, chars, length)) return RESULT_FAILED;
     return RESULT_SUCCESS;
 }
 
 static ResultCode define_append(struct Compiler* compiler) {
     struct TypeArray* params = make_type_array();
-    add_type(params, make_file_type());
-    add_type(params, make_string_type());
+    struct Type* dest_type = copy_type(make_file_type());
+    dest_type->opt = make_string_builder_type();
+    add_type(params, dest_type);
+    struct Type* src_type = copy_type(make_string_type());
+    src_type->opt = make_string_builder_type();
+    add_type(params, src_type);
     struct TypeArray* returns = make_type_array();
     add_type(returns, make_nil_type());
     return define_native(compiler, "append", append_native, make_fun_type(params, returns));
 }
 
-static ResultCode process_next_line(struct ObjFile* file) {
-    char input[256];
-    char* result = fgets(input, 256, file->fp);
-    if (result != NULL) {
-        int len = input[strlen(input) - 1] == '\n' ? strlen(input) - 1 : strlen(input);
-        file->next_line = make_string(input, len);
-        file->is_eof = false;
-    } else {
-        file->next_line = make_string("", 0);
-        file->is_eof = true;
-    }
-
-    return RESULT_SUCCESS;
-}
-
 static ResultCode rewind_native(Value* args, struct ValueArray* returns) {
     struct ObjFile* file = args[0].as.file_type;
+    flush_file(file);
     rewind(file->fp);
-    file->is_eof = false;
-    process_next_line(file);
+    reset_file_buffer(file);
     add_value(returns, to_nil()); 
     return RESULT_SUCCESS;
 }
@@ -181,7 +159,7 @@ static ResultCode define_rewind(struct Compiler* compiler) {
 
 static ResultCode eof_native(Value* args, struct ValueArray* returns) {
     struct ObjFile* file = args[0].as.file_type;
-    add_value(returns, to_boolean(file->is_eof)); 
+    add_value(returns, to_boolean(at_file_end(file))); 
     return RESULT_SUCCESS;
 }
 
@@ -202,11 +180,8 @@ static ResultCode read_line_native(Value* args, struct ValueArray* returns) {
         return RESULT_FAILED;
     }
 
-    struct ObjString* line = file->next_line;
+    struct ObjString* line = read_file_line(file);
     push_root(to_string(line));
-
-    process_next_line(file);
-
     add_value(returns, to_string(line));
     pop_root();
 
@@ -225,13 +200,13 @@ static ResultCode define_read_line(struct Compiler* compiler) {
 static ResultCode close_native(Value* args, struct ValueArray* returns) {
     struct ObjFile* file = args[0].as.file_type;
     add_value(returns, to_nil());
-    if (file->fp != NULL) {
-        fclose(file->fp);
-        file->fp = NULL;
-        return RESULT_SUCCESS;
-    }
+    if (file->fp == NULL) return RESULT_FAILED;
 
-    return RESULT_FAILED;
+    //pending appends are written first - the file is closed even if that fails
+    bool written = flush_file(file);
+    fclose(file->fp);
+    file->fp = NULL;
+    return written ? RESULT_SUCCESS : RESULT_FAILED;
 }
 
 static ResultCode define_close(struct Compiler* compiler) {
@@ -242,6 +217,38 @@ static ResultCode define_close(struct Compiler* compiler) {
     return define_native(compiler, "close", close_native, make_fun_type(params, returns));
 }
 
+static ResultCode file_flush_native(Value* args, struct ValueArray* returns) {
+    add_value(returns, to_nil());
+    return flush_file(args[0].as.file_type) ? RESULT_SUCCESS : RESULT_FAILED;
+}
+
+static ResultCode define_file_flush(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "file_flush", file_flush_native, make_fun_type(params, returns));
+}
+
+//Appends to the file are kept in a buffer of the given size and only written when it fills, or on
+//flush() and close().  A size of 0 (the default) writes every append straight away.
+static ResultCode buffer_writes_native(Value* args, struct ValueArray* returns) {
+    struct ObjFile* file = args[0].as.file_type;
+    int size = args[1].as.integer_type;
+    add_value(returns, to_nil());
+    if (file->fp == NULL || size < 0 || !set_file_write_buffer(file, size)) return RESULT_FAILED;
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_buffer_writes(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    add_type(params, make_int_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "buffer_writes", buffer_writes_native, make_fun_type(params, returns));
+}
+
 static ResultCode read_all_bytes(Value* args, struct ValueArray* returns) {
     FILE* fp = args[0].as.file_type->fp;
     if (fp == NULL) {
@@ -249,6 +256,9 @@ static ResultCode read_all_bytes(Value* args, struct ValueArray* returns) {
         return RESULT_FAILED;
     }
 
+    flush_file(args[0].as.file_type);
+    reset_file_buffer(args[0].as.file_type);
+
     if (fseek(fp, 0L, SEEK_END) != 0) {
         fprintf(stderr, "fseek() failed.");
         exit(1);
@@ -261,28 +271,22 @@ static ResultCode read_all_bytes(Value* args, struct ValueArray* returns) {
     }
 
     rewind(fp);
-    char* buffer = ALLOCATE_ARRAY(char);
-    buffer = GROW_ARRAY(buffer, char, file_size + 1, 0);
 
-    long bytes_read = fread(buffer, sizeof(char), file_size, fp);
+    //read directly into the packed bytes of the List
+    struct ObjList* list = make_list(LIST_BYTE);
+    push_root(to_list(list));
+    reserve_list(list, file_size);
+
+    long bytes_read = fread(list->data, sizeof(uint8_t), file_size, fp);
     if (bytes_read != file_size && feof(fp) == 0) {
         fprintf(stderr, "fread() failed.");
         exit(1);
     }
 
-    buffer[bytes_read] = '\0';
-
-    //make a byte from each char, and add to List
-    struct ObjList* list = make_list();
-    push_root(to_list(list));
-    for (int i = 0; i < bytes_read; i++) {
-        add_value(&list->values, to_byte((uint8_t)buffer[i]));
-    }
+    list->count = bytes_read;
     add_value(returns, to_list(list));
     pop_root(); 
 
-    FREE_ARRAY(buffer, char, file_size + 1);
-
     return RESULT_SUCCESS;
 }
 
@@ -301,6 +305,9 @@ static ResultCode read_all_native(Value* args, struct ValueArray* returns) {
     if (fp == NULL)
         exit(1);
 
+    flush_file(args[0].as.file_type);
+    reset_file_buffer(args[0].as.file_type);
+
     if (fseek(fp, 0L, SEEK_END) != 0) {
         fprintf(stderr, "fseek() failed.");
         exit(1);
@@ -313,18 +320,18 @@ static ResultCode read_all_native(Value* args, struct ValueArray* returns) {
     }
 
     rewind(fp);
-    char* buffer = ALLOCATE_ARRAY(char);
-    buffer = GROW_ARRAY(buffer, char, file_size + 1, 0);
+    struct ObjString* s = allocate_string(file_size);
 
-    long bytes_read = fread(buffer, sizeof(char), file_size, fp);
+    long bytes_read = fread(s->chars, sizeof(char), file_size, fp);
     if (bytes_read != file_size && feof(fp) == 0) {
         fprintf(stderr, "fread() failed.");
         exit(1);
     }
 
-    buffer[bytes_read] = '\0';
+    memset(s->chars + bytes_read, '\0', file_size - bytes_read);
    
-    struct ObjString* s = take_string(buffer, file_size);
+    //file contents are not hashed or interned
+    track_string(s);
     push_root(to_string(s)); 
     add_value(returns, to_string(s));
     pop_root();
@@ -335,17 +342,139 @@ static ResultCode define_read_all(struct Compiler* compiler) {
     struct TypeArray* params = make_type_array();
     add_type(params, make_file_type());
     struct TypeArray* returns = make_type_array();
-    struct Type* s_type = make_string_type();
+    struct Type* s_type = copy_type(make_string_type());
     s_type->opt = make_nil_type();
     add_type(returns, s_type);
     return define_native(compiler, "read_all", read_all_native, make_fun_type(params, returns));
 }
 
+static ResultCode file_mmap_native(Value* args, struct ValueArray* returns) {
+    struct ObjBytes* bytes = map_file(args[0].as.string_type->chars);
+    if (bytes == NULL) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    push_root(to_bytes(bytes));
+    add_value(returns, to_bytes(bytes));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_file_mmap(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_string_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_bytes_type());
+    return define_native(compiler, "file_mmap", file_mmap_native, make_fun_type(params, returns));
+}
+
+//Reads the 'width' bytes at 'offset' as an unsigned integer
+static bool decode_bytes(Value* args, int max_width, uint64_t* bits) {
+    struct ObjBytes* bytes = args[0].as.bytes_type;
+    int offset = args[1].as.integer_type;
+    int width = args[2].as.integer_type;
+    bool big_endian = args[3].as.boolean_type;
+    if (width < 1 || width > max_width || offset < 0 || offset > bytes->length - width) return false;
+
+    *bits = 0;
+    for (int i = 0; i < width; i++) {
+        int shift = big_endian ? (width - 1 - i) * 8 : i * 8;
+        *bits |= (uint64_t)bytes->data[offset + i] << shift;
+    }
+    return true;
+}
+
+static struct TypeArray* decode_params(void) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_bytes_type());
+    add_type(params, make_int_type());
+    add_type(params, make_int_type());
+    add_type(params, make_bool_type());
+    return params;
+}
+
+//1 and 2 byte integers are unsigned, 4 byte integers are signed
+static ResultCode decode_int_native(Value* args, struct ValueArray* returns) {
+    uint64_t bits;
+    if (args[2].as.integer_type == 3 || !decode_bytes(args, 4, &bits)) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    add_value(returns, to_integer((int32_t)(uint32_t)bits));
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_decode_int(struct Compiler* compiler) {
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_int_type());
+    return define_native(compiler, "decode_int", decode_int_native, make_fun_type(decode_params(), returns));
+}
+
+//4 or 8 byte IEEE floats
+static ResultCode decode_float_native(Value* args, struct ValueArray* returns) {
+    int width = args[2].as.integer_type;
+    uint64_t bits;
+    if ((width != 4 && width != 8) || !decode_bytes(args, 8, &bits)) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    if (width == 4) {
+        uint32_t bits32 = (uint32_t)bits;
+        float f;
+        memcpy(&f, &bits32, sizeof(float));
+        add_value(returns, to_float(f));
+    } else {
+        double d;
+        memcpy(&d, &bits, sizeof(double));
+        add_value(returns, to_float(d));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_decode_float(struct Compiler* compiler) {
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_float_type());
+    return define_native(compiler, "decode_float", decode_float_native, make_fun_type(decode_params(), returns));
+}
+
 static ResultCode clear_native(Value* args, struct ValueArray* returns) {
+    if (args[0].type == VAL_MAP) {
+        //a view just lets go of the entries it shares
+        struct ObjMap* map = args[0].as.map_type;
+        if (IS_FOREIGN(map)) return foreign_argument();
+        if (map->frozen != NULL) {
+            map->frozen = NULL;
+        } else {
+            clear_value_table(&map->table);
+        }
+        add_value(returns, to_nil());
+        return RESULT_SUCCESS;
+    }
+
+    if (args[0].type == VAL_STRING_BUILDER) {
+        struct ObjStringBuilder* sb = args[0].as.string_builder_type;
+        sb->length = 0;
+        sb->chars[0] = '\0';
+        add_value(returns, to_nil());
+        return RESULT_SUCCESS;
+    }
+
+    //files opened read-only can't be cleared
     struct ObjFile* file = args[0].as.file_type;
+    if (file->fp == NULL || (file->mode[0] == 'r' && strchr(file->mode, '+') == NULL)) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    //appends waiting to be written would be cleared anyway
+    file->write_count = 0;
     fclose(file->fp);
 
-    //what the heck is going on here?    
+    //truncate the file, then reopen it the way it was opened - 'w' becomes 'a' so that
+    //the file isn't truncated again and writes still go to the end
     file->fp = fopen(file->file_path->chars, "w");
     if (file->fp == NULL) {
         fprintf(stderr, "fopen() failed.");
@@ -353,40 +482,51 @@ static ResultCode clear_native(Value* args, struct ValueArray* returns) {
     }
     fclose(file->fp);
 
-    file->fp = fopen(file->file_path->chars, "a+");
+    char mode[sizeof(file->mode)];
+    memcpy(mode, file->mode, sizeof(mode));
+    if (mode[0] == 'w') mode[0] = 'a';
+    file->fp = fopen(file->file_path->chars, mode);
     if (file->fp == NULL) {
         fprintf(stderr, "fopen() failed.");
         exit(1);
     }
 
-    process_next_line(file);
+    reset_file_buffer(file);
     add_value(returns, to_nil());
     return RESULT_SUCCESS;
 }
 
 static ResultCode define_clear(struct Compiler* compiler) {
     struct TypeArray* params = make_type_array();
-    add_type(params, make_file_type());
+    struct Type* file_type = copy_type(make_file_type());
+    struct Type* sb_type = copy_type(make_string_builder_type());
+    file_type->opt = sb_type;
+    sb_type->opt = make_map_type(make_nil_type(), make_nil_type());
+    add_type(params, file_type);
     struct TypeArray* returns = make_type_array();
     add_type(returns, make_nil_type());
     return define_native(compiler, "clear", clear_native, make_fun_type(params, returns));
 }
 
 
-static ResultCode open_native(Value* args, struct ValueArray* returns) {
-    FILE* fp;
-    fp = fopen(args[0].as.string_type->chars, "a+");
-    if (fp == NULL)
-        exit(1);
+static ResultCode open_file(struct ObjString* path, const char* mode, struct ValueArray* returns) {
+    FILE* fp = fopen(path->chars, mode);
+    if (fp == NULL) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
 
-    struct ObjFile* file = make_file(fp, args[0].as.string_type);
+    struct ObjFile* file = make_file(fp, path, mode);
     push_root(to_file(file));
-    process_next_line(file);
     add_value(returns, to_file(file));
     pop_root();
     return RESULT_SUCCESS;
 }
 
+static ResultCode open_native(Value* args, struct ValueArray* returns) {
+    return open_file(args[0].as.string_type, "a+", returns);
+}
+
 
 static ResultCode define_open(struct Compiler* compiler) {
     struct TypeArray* params = make_type_array();
@@ -396,16 +536,212 @@ static ResultCode define_open(struct Compiler* compiler) {
     return define_native(compiler, "open", open_native, make_fun_type(params, returns));
 }
 
+//fopen modes: 'r', 'w' or 'a', optionally followed by '+' and/or 'b'
+static bool valid_open_mode(const char* mode) {
+    if (mode[0] != 'r' && mode[0] != 'w' && mode[0] != 'a') return false;
+    const char* rest = mode + 1;
+    return strcmp(rest, "") == 0 || strcmp(rest, "+") == 0 || strcmp(rest, "b") == 0 ||
+           strcmp(rest, "+b") == 0 || strcmp(rest, "b+") == 0;
+}
+
+static ResultCode open_with_native(Value* args, struct ValueArray* returns) {
+    const char* mode = args[1].as.string_type->chars;
+    if (!valid_open_mode(mode)) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+    return open_file(args[0].as.string_type, mode, returns);
+}
+
+static ResultCode define_open_with(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_string_type());
+    add_type(params, make_string_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_file_type());
+    return define_native(compiler, "open_with", open_with_native, make_fun_type(params, returns));
+}
+
+static ResultCode read_chunk_native(Value* args, struct ValueArray* returns) {
+    struct ObjFile* file = args[0].as.file_type;
+    int count = args[1].as.integer_type;
+    if (file->fp == NULL || count < 0) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    struct ObjBytes* bytes = read_file_bytes(file, count);
+    push_root(to_bytes(bytes));
+    add_value(returns, to_bytes(bytes));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_read_chunk(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    add_type(params, make_int_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_bytes_type());
+    return define_native(compiler, "read_chunk", read_chunk_native, make_fun_type(params, returns));
+}
+
+static ResultCode write_bytes_native(Value* args, struct ValueArray* returns) {
+    struct ObjFile* file = args[0].as.file_type;
+    add_value(returns, to_nil());
+
+    const uint8_t* data;
+    int length;
+    if (args[1].type == VAL_BYTES) {
+        data = args[1].as.bytes_type->data;
+        length = args[1].as.bytes_type->length;
+    } else {
+        struct ObjList* list = args[1].as.list_type;
+        if (list->kind != LIST_BYTE && list->count > 0) return RESULT_FAILED;
+        data = LIST_DATA(list, uint8_t);
+        length = list->count;
+    }
+
+    if (file->fp == NULL) return RESULT_FAILED;
+
+    //C streams need a seek between reading and writing - this also drops the line buffer
+    long position = file_position(file);
+    if (position == -1L || !seek_file(file, position)) return RESULT_FAILED;
+
+    if (length > 0 && fwrite(data, sizeof(uint8_t), length, file->fp) != (size_t)length) return RESULT_FAILED;
+    fflush(file->fp);
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_write_bytes(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    struct Type* bytes_type = copy_type(make_bytes_type());
+    bytes_type->opt = make_list_type(make_byte_type());
+    add_type(params, bytes_type);
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "write_bytes", write_bytes_native, make_fun_type(params, returns));
+}
+
+//Positions are offsets from the start of the file
+static ResultCode file_seek_native(Value* args, struct ValueArray* returns) {
+    struct ObjFile* file = args[0].as.file_type;
+    int position = args[1].as.integer_type;
+    add_value(returns, to_nil());
+    if (file->fp == NULL || position < 0 || !seek_file(file, position)) return RESULT_FAILED;
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_file_seek(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    add_type(params, make_int_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "file_seek", file_seek_native, make_fun_type(params, returns));
+}
+
+static ResultCode file_tell_native(Value* args, struct ValueArray* returns) {
+    struct ObjFile* file = args[0].as.file_type;
+    long position = file->fp == NULL ? -1L : file_position(file);
+    if (position == -1L || position > INT32_MAX) {
+        add_value(returns, to_nil());
+        return RESULT_FAILED;
+    }
+
+    add_value(returns, to_integer((int32_t)position));
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_file_tell(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_file_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_int_type());
+    return define_native(compiler, "file_tell", file_tell_native, make_fun_type(params, returns));
+}
+
+
+static ResultCode string_builder_native(Value* args, struct ValueArray* returns) {
+    args = args; //silence warning
+    struct ObjStringBuilder* sb = make_string_builder();
+    push_root(to_string_builder(sb));
+    add_value(returns, to_string_builder(sb));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_string_builder(struct Compiler* compiler) {
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_string_builder_type());
+    return define_native(compiler, "string_builder", string_builder_native, make_fun_type(make_type_array(), returns));
+}
+
+static ResultCode append_int_native(Value* args, struct ValueArray* returns) {
+    char buffer[16];
+    int length = sprintf(buffer, "%d", args[1].as.integer_type);
+    append_to_string_builder(args[0].as.string_builder_type, buffer, length);
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_append_int(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_string_builder_type());
+    add_type(params, make_int_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "append_int", append_int_native, make_fun_type(params, returns));
+}
+
+static ResultCode append_float_native(Value* args, struct ValueArray* returns) {
+    char buffer[400]; //%f of DBL_MAX is over 300 chars
+    int length = sprintf(buffer, "%f", args[1].as.float_type);
+    append_to_string_builder(args[0].as.string_builder_type, buffer, length);
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_append_float(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_string_builder_type());
+    add_type(params, make_float_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "append_float", append_float_native, make_fun_type(params, returns));
+}
+
+static ResultCode build_string_native(Value* args, struct ValueArray* returns) {
+    struct ObjStringBuilder* sb = args[0].as.string_builder_type;
+    struct ObjString* s = make_string(sb->chars, sb->length);
+    push_root(to_string(s));
+    add_value(returns, to_string(s));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_build_string(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_string_builder_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_string_type());
+    return define_native(compiler, "build_string", build_string_native, make_fun_type(params, returns));
+}
 
 static ResultCode input_native(Value* args, struct ValueArray* returns) {
     args = args; //silence warning
+    //anything printed so far (eg. a prompt) is shown before waiting for input
+    fflush(stdout);
     char buffer[256];
     char* input = fgets(buffer, 256, stdin); //if NULL and feof(file) == 0
     if (input == NULL && feof(stdin) == 0) {
         fprintf(stderr, "fgets() failed.");
         exit(1);
     }
-    struct ObjString* s = make_string(input, strlen(input) - 1);
+    int length = input == NULL ? 0 : strlen(input);
+    if (length > 0 && input[length - 1] == '\n') length--;
+    struct ObjString* s = make_string(buffer, length);
     push_root(to_string(s));
     add_value(returns, to_string(s));
     pop_root();
@@ -430,38 +766,18 @@ static ResultCode define_clock(struct Compiler* compiler) {
     return define_native(compiler, "clock", clock_native, make_fun_type(make_type_array(), returns));
 }
 
-static ResultCode print_string_with_escape_sequences(char* s) {
-    char* start = s;
-    char* back_slash = strchr(start, '\\');
-    while (back_slash != NULL) {
-        printf("%.*s", (int)(back_slash-start), start);
-        switch(*(back_slash + 1)) {
-            case 'a': printf("\a"); break;
-            case 'b': printf("\b"); break;
-            case 'f': printf("\f"); break;
-            case 'n': printf("\n"); break;
-            case 'r': printf("\r"); break;
-            case 't': printf("\t"); break;
-            case 'v': printf("\v"); break;
-            case '\\': printf("\\"); break;
-            case '\'': printf("\'"); break;
-            case '\"': printf("\""); break;
-            case '?': printf("\?"); break;
-        }
-        start = back_slash + 2;
-        back_slash = strchr(start, '\\');
-    }
-
-    printf("%s", start);
-    return RESULT_SUCCESS;
-}
-
 static ResultCode print_native(Value* args, struct ValueArray* returns) {
     Value value = args[0];
     switch(value.type) {
+        //escape sequences were decoded when the literals were compiled, so strings are written as is
         case VAL_STRING: {
             struct ObjString* s = value.as.string_type;
-            print_string_with_escape_sequences(s->chars);
+            fwrite(s->chars, sizeof(char), s->length, stdout);
+            break;
+        }
+        case VAL_STRING_BUILDER: {
+            struct ObjStringBuilder* sb = value.as.string_builder_type;
+            fwrite(sb->chars, sizeof(char), sb->length, stdout);
             break;
         }
         case VAL_INT:
@@ -484,11 +800,11 @@ static ResultCode print_native(Value* args, struct ValueArray* returns) {
 }
 
 static ResultCode define_print(struct Compiler* compiler) {
-    struct Type* str_type = make_string_type();
-    struct Type* int_type = make_int_type();
-    struct Type* byte_type = make_byte_type();
-    struct Type* float_type = make_float_type();
-    struct Type* nil_type = make_nil_type();
+    struct Type* str_type = copy_type(make_string_type());
+    struct Type* int_type = copy_type(make_int_type());
+    struct Type* byte_type = copy_type(make_byte_type());
+    struct Type* float_type = copy_type(make_float_type());
+    struct Type* nil_type = copy_type(make_nil_type());
     //using dummy token with enum type to allow printing enums (as integer)
     //otherwise the typechecker sees it as an error
     struct Type* enum_type = make_enum_type(make_dummy_token());
@@ -497,6 +813,7 @@ static ResultCode define_print(struct Compiler* compiler) {
     byte_type->opt = float_type;
     float_type->opt = nil_type;
     nil_type->opt = enum_type;
+    enum_type->opt = make_string_builder_type();
     struct TypeArray* sl = make_type_array();
     add_type(sl, str_type);
     struct TypeArray* returns = make_type_array();
@@ -504,6 +821,710 @@ static ResultCode define_print(struct Compiler* compiler) {
     return define_native(compiler, "print", print_native, make_fun_type(sl, returns));
 }
 
+/*
+ * Vector math over List<float> and List<int> - these need packed lists, so they fail on
+ * lists holding nils, and binary operations need both lists to have the same size and kind
+ */
+
+static bool numeric_list(struct ObjList* list) {
+    return list->kind == LIST_FLOAT || list->kind == LIST_INT;
+}
+
+static bool matching_lists(struct ObjList* a, struct ObjList* b) {
+    return numeric_list(a) && a->kind == b->kind && a->count == b->count;
+}
+
+static struct Type* make_numeric_list_type(void) {
+    struct Type* f = copy_type(make_float_type());
+    f->opt = make_int_type();
+    return make_list_type(f);
+}
+
+static ResultCode vec_sum_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* x = args[0].as.list_type;
+    if (!numeric_list(x)) return RESULT_FAILED;
+    if (x->kind == LIST_FLOAT) {
+        add_value(returns, to_float(vector_sum(LIST_DATA(x, double), x->count)));
+    } else {
+        add_value(returns, to_float((double)vector_sum_int(LIST_DATA(x, int32_t), x->count)));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_sum(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_numeric_list_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_float_type());
+    return define_native(compiler, "vec_sum", vec_sum_native, make_fun_type(params, returns));
+}
+
+static ResultCode vec_dot_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* x = args[0].as.list_type;
+    struct ObjList* y = args[1].as.list_type;
+    if (!matching_lists(x, y)) return RESULT_FAILED;
+    if (x->kind == LIST_FLOAT) {
+        add_value(returns, to_float(vector_dot(LIST_DATA(x, double), LIST_DATA(y, double), x->count)));
+    } else {
+        add_value(returns, to_float((double)vector_dot_int(LIST_DATA(x, int32_t), LIST_DATA(y, int32_t), x->count)));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_dot(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_numeric_list_type());
+    add_type(params, make_numeric_list_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_float_type());
+    return define_native(compiler, "vec_dot", vec_dot_native, make_fun_type(params, returns));
+}
+
+static ResultCode vec_min_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* x = args[0].as.list_type;
+    if (!numeric_list(x) || x->count == 0) return RESULT_FAILED;
+    if (x->kind == LIST_FLOAT) {
+        add_value(returns, to_float(vector_min(LIST_DATA(x, double), x->count)));
+    } else {
+        add_value(returns, to_float((double)vector_min_int(LIST_DATA(x, int32_t), x->count)));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_min(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_numeric_list_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_float_type());
+    return define_native(compiler, "vec_min", vec_min_native, make_fun_type(params, returns));
+}
+
+static ResultCode vec_max_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* x = args[0].as.list_type;
+    if (!numeric_list(x) || x->count == 0) return RESULT_FAILED;
+    if (x->kind == LIST_FLOAT) {
+        add_value(returns, to_float(vector_max(LIST_DATA(x, double), x->count)));
+    } else {
+        add_value(returns, to_float((double)vector_max_int(LIST_DATA(x, int32_t), x->count)));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_max(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_numeric_list_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_float_type());
+    return define_native(compiler, "vec_max", vec_max_native, make_fun_type(params, returns));
+}
+
+static ResultCode vec_argmax_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* x = args[0].as.list_type;
+    if (!numeric_list(x) || x->count == 0) return RESULT_FAILED;
+    if (x->kind == LIST_FLOAT) {
+        add_value(returns, to_integer(vector_argmax(LIST_DATA(x, double), x->count)));
+    } else {
+        add_value(returns, to_integer(vector_argmax_int(LIST_DATA(x, int32_t), x->count)));
+    }
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_argmax(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_numeric_list_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_int_type());
+    return define_native(compiler, "vec_argmax", vec_argmax_native, make_fun_type(params, returns));
+}
+
+//y = a * x + y
+static ResultCode vec_axpy_native(Value* args, struct ValueArray* returns) {
+    double a = args[0].as.float_type;
+    struct ObjList* x = args[1].as.list_type;
+    struct ObjList* y = args[2].as.list_type;
+    if (x->kind != LIST_FLOAT || !matching_lists(x, y)) return RESULT_FAILED;
+    if (IS_FOREIGN(y)) return foreign_argument();
+    materialize_list(y);
+    vector_axpy(a, LIST_DATA(x, double), LIST_DATA(y, double), x->count);
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_axpy(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_float_type());
+    add_type(params, make_list_type(make_float_type()));
+    add_type(params, make_list_type(make_float_type()));
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "vec_axpy", vec_axpy_native, make_fun_type(params, returns));
+}
+
+static ResultCode vec_scale_native(Value* args, struct ValueArray* returns) {
+    if (args[0].type == VAL_TENSOR) {
+        struct ObjTensor* t = args[0].as.tensor_type;
+        if (IS_FOREIGN(t)) return foreign_argument();
+        materialize_tensor(t);
+        vector_scale(args[1].as.float_type, t->data, t->count);
+        add_value(returns, to_nil());
+        return RESULT_SUCCESS;
+    }
+
+    struct ObjList* x = args[0].as.list_type;
+    if (x->kind != LIST_FLOAT) return RESULT_FAILED;
+    if (IS_FOREIGN(x)) return foreign_argument();
+    materialize_list(x);
+    vector_scale(args[1].as.float_type, LIST_DATA(x, double), x->count);
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_vec_scale(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    struct Type* list_type = make_list_type(make_float_type());
+    list_type->opt = make_tensor_type();
+    add_type(params, list_type);
+    add_type(params, make_float_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "vec_scale", vec_scale_native, make_fun_type(params, returns));
+}
+
+static bool same_shape(struct ObjTensor* a, struct ObjTensor* b) {
+    if (a->rank != b->rank) return false;
+    for (int i = 0; i < a->rank; i++) {
+        if (a->shape[i] != b->shape[i]) return false;
+    }
+    return true;
+}
+
+//Returns the tensor in 'arg' with its elements in row-major order.  Views are materialized,
+//except those shared with a parallel worker (which are read-only) - those are copied
+//and the copy replaces the argument so that it stays reachable.
+static struct ObjTensor* contiguous_arg(Value* arg) {
+    struct ObjTensor* t = arg->as.tensor_type;
+    if (tensor_is_contiguous(t)) return t;
+    if (IS_FOREIGN(t)) {
+        arg->as.tensor_type = copy_tensor(t);
+    } else {
+        materialize_tensor(t);
+    }
+    return arg->as.tensor_type;
+}
+
+//y = y op x, elementwise
+static ResultCode elements_native(VectorOp op, Value* args, struct ValueArray* returns) {
+    if (args[0].type == VAL_TENSOR || args[1].type == VAL_TENSOR) {
+        if (args[0].type != args[1].type) return RESULT_FAILED;
+        struct ObjTensor* y = args[0].as.tensor_type;
+        if (!same_shape(args[1].as.tensor_type, y)) return RESULT_FAILED;
+        if (IS_FOREIGN(y)) return foreign_argument();
+        materialize_tensor(y);
+        struct ObjTensor* x = contiguous_arg(&args[1]);
+        vector_op(op, y->data, TENSOR_DATA(x), y->count);
+        add_value(returns, to_nil());
+        return RESULT_SUCCESS;
+    }
+
+    struct ObjList* y = args[0].as.list_type;
+    struct ObjList* x = args[1].as.list_type;
+    if (!matching_lists(x, y)) return RESULT_FAILED;
+    if (IS_FOREIGN(y)) return foreign_argument();
+    materialize_list(y);
+    if (y->kind == LIST_FLOAT) {
+        vector_op(op, LIST_DATA(y, double), LIST_DATA(x, double), y->count);
+    } else if (!vector_op_int(op, LIST_DATA(y, int32_t), LIST_DATA(x, int32_t), y->count)) {
+        return RESULT_FAILED;
+    }
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode vec_add_native(Value* args, struct ValueArray* returns) {
+    return elements_native(VECTOR_ADD, args, returns);
+}
+
+static ResultCode vec_sub_native(Value* args, struct ValueArray* returns) {
+    return elements_native(VECTOR_SUB, args, returns);
+}
+
+static ResultCode vec_mul_native(Value* args, struct ValueArray* returns) {
+    return elements_native(VECTOR_MUL, args, returns);
+}
+
+static ResultCode vec_div_native(Value* args, struct ValueArray* returns) {
+    return elements_native(VECTOR_DIV, args, returns);
+}
+
+static ResultCode define_elements(struct Compiler* compiler, const char* name, ResultCode (*function)(Value*, struct ValueArray*)) {
+    struct TypeArray* params = make_type_array();
+    struct Type* y_type = make_numeric_list_type();
+    y_type->opt = make_tensor_type();
+    struct Type* x_type = make_numeric_list_type();
+    x_type->opt = make_tensor_type();
+    add_type(params, y_type);
+    add_type(params, x_type);
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, name, function, make_fun_type(params, returns));
+}
+
+
+/*
+ * Tensor<float>
+ */
+
+//shapes are given as a List<int> of 1 to TENSOR_MAX_RANK positive sizes
+static bool read_shape(struct ObjList* list, int* rank, int* shape) {
+    if (list->count < 1 || list->count > TENSOR_MAX_RANK) return false;
+    *rank = list->count;
+    for (int i = 0; i < list->count; i++) {
+        Value size = list_get(list, i);
+        if (size.type != VAL_INT || size.as.integer_type <= 0) return false;
+        shape[i] = size.as.integer_type;
+    }
+    return true;
+}
+
+static ResultCode tensor_zeros_native(Value* args, struct ValueArray* returns) {
+    int rank;
+    int shape[TENSOR_MAX_RANK];
+    if (!read_shape(args[0].as.list_type, &rank, shape)) return RESULT_FAILED;
+    struct ObjTensor* t = make_tensor(rank, shape);
+    push_root(to_tensor(t));
+    add_value(returns, to_tensor(t));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_zeros(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_list_type(make_int_type()));
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "tensor_zeros", tensor_zeros_native, make_fun_type(params, returns));
+}
+
+static ResultCode to_tensor_native(Value* args, struct ValueArray* returns) {
+    struct ObjList* values = args[0].as.list_type;
+    int rank;
+    int shape[TENSOR_MAX_RANK];
+    if (!read_shape(args[1].as.list_type, &rank, shape)) return RESULT_FAILED;
+    struct ObjTensor* t = make_tensor(rank, shape);
+    if (t->count != values->count) return RESULT_FAILED;
+
+    for (int i = 0; i < t->count; i++) {
+        Value v = list_get(values, i);
+        switch (v.type) {
+            case VAL_FLOAT: t->data[i] = v.as.float_type; break;
+            case VAL_INT: t->data[i] = (double)v.as.integer_type; break;
+            case VAL_BYTE: t->data[i] = (double)v.as.byte_type; break;
+            default: return RESULT_FAILED;
+        }
+    }
+
+    push_root(to_tensor(t));
+    add_value(returns, to_tensor(t));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_to_tensor(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    struct Type* f = copy_type(make_float_type());
+    struct Type* i = copy_type(make_int_type());
+    f->opt = i;
+    i->opt = make_byte_type();
+    add_type(params, make_list_type(f));
+    add_type(params, make_list_type(make_int_type()));
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "to_tensor", to_tensor_native, make_fun_type(params, returns));
+}
+
+static ResultCode random_tensor_native(Value* args, struct ValueArray* returns) {
+    int rank;
+    int shape[TENSOR_MAX_RANK];
+    if (!read_shape(args[0].as.list_type, &rank, shape)) return RESULT_FAILED;
+    double start = args[1].as.float_type;
+    double end = args[2].as.float_type;
+    struct ObjTensor* t = make_tensor(rank, shape);
+    for (int i = 0; i < t->count; i++) {
+        t->data[i] = (double)rand()/RAND_MAX * (end - start) + start;
+    }
+    push_root(to_tensor(t));
+    add_value(returns, to_tensor(t));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_random_tensor(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_list_type(make_int_type()));
+    add_type(params, make_float_type());
+    add_type(params, make_float_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "random_tensor", random_tensor_native, make_fun_type(params, returns));
+}
+
+//elements in row-major order
+static ResultCode tensor_values_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = contiguous_arg(&args[0]);
+    struct ObjList* list = make_list(LIST_FLOAT);
+    push_root(to_list(list));
+    reserve_list(list, t->count);
+    memcpy(list->data, TENSOR_DATA(t), sizeof(double) * t->count);
+    list->count = t->count;
+    add_value(returns, to_list(list));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_values(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_list_type(make_float_type()));
+    return define_native(compiler, "tensor_values", tensor_values_native, make_fun_type(params, returns));
+}
+
+static ResultCode tensor_shape_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    struct ObjList* list = make_list(LIST_INT);
+    push_root(to_list(list));
+    for (int i = 0; i < t->rank; i++) {
+        list_append(list, to_integer(t->shape[i]));
+    }
+    add_value(returns, to_list(list));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_shape(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_list_type(make_int_type()));
+    return define_native(compiler, "tensor_shape", tensor_shape_native, make_fun_type(params, returns));
+}
+
+//shares the elements of the tensor unless it's a non-contiguous view
+static ResultCode tensor_reshape_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    int rank;
+    int shape[TENSOR_MAX_RANK];
+    if (!read_shape(args[1].as.list_type, &rank, shape)) return RESULT_FAILED;
+
+    int count = 1;
+    int strides[TENSOR_MAX_RANK];
+    for (int i = rank - 1; i >= 0; i--) {
+        strides[i] = count;
+        count *= shape[i];
+    }
+    if (count != t->count) return RESULT_FAILED;
+
+    t = contiguous_arg(&args[0]);
+    struct ObjTensor* view = make_tensor_view(t, rank, shape, strides);
+    push_root(to_tensor(view));
+    add_value(returns, to_tensor(view));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_reshape(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    add_type(params, make_list_type(make_int_type()));
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "tensor_reshape", tensor_reshape_native, make_fun_type(params, returns));
+}
+
+//swaps the last two dimensions without copying
+static ResultCode tensor_transpose_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    if (t->rank < 2) return RESULT_FAILED;
+
+    int shape[TENSOR_MAX_RANK];
+    int strides[TENSOR_MAX_RANK];
+    for (int i = 0; i < t->rank; i++) {
+        shape[i] = t->shape[i];
+        strides[i] = t->strides[i];
+    }
+    int last = t->rank - 1;
+    shape[last] = t->shape[last - 1];
+    shape[last - 1] = t->shape[last];
+    strides[last] = t->strides[last - 1];
+    strides[last - 1] = t->strides[last];
+
+    struct ObjTensor* view = make_tensor_view(t, t->rank, shape, strides);
+    push_root(to_tensor(view));
+    add_value(returns, to_tensor(view));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_transpose(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "tensor_transpose", tensor_transpose_native, make_fun_type(params, returns));
+}
+
+static ResultCode tensor_matmul_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* a = args[0].as.tensor_type;
+    struct ObjTensor* b = args[1].as.tensor_type;
+    if (a->rank != 2 || b->rank != 2 || a->shape[1] != b->shape[0]) return RESULT_FAILED;
+    a = contiguous_arg(&args[0]);
+    b = contiguous_arg(&args[1]);
+
+    int shape[2] = {a->shape[0], b->shape[1]};
+    struct ObjTensor* c = make_tensor(2, shape);
+    push_root(to_tensor(c));
+    matrix_multiply(TENSOR_DATA(a), TENSOR_DATA(b), c->data, a->shape[0], a->shape[1], b->shape[1]);
+    add_value(returns, to_tensor(c));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_matmul(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_tensor_type());
+    return define_native(compiler, "tensor_matmul", tensor_matmul_native, make_fun_type(params, returns));
+}
+
+//Adds 'bias' to every slice of 't' with the same shape as 'bias' (eg, a row vector to each row)
+static ResultCode tensor_add_bias_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    struct ObjTensor* bias = args[1].as.tensor_type;
+    if (bias->rank > t->rank) return RESULT_FAILED;
+    for (int i = 1; i <= bias->rank; i++) {
+        if (bias->shape[bias->rank - i] != t->shape[t->rank - i]) return RESULT_FAILED;
+    }
+
+    if (IS_FOREIGN(t)) return foreign_argument();
+    materialize_tensor(t);
+    bias = contiguous_arg(&args[1]);
+    for (int i = 0; i < t->count; i += bias->count) {
+        vector_op(VECTOR_ADD, t->data + i, TENSOR_DATA(bias), bias->count);
+    }
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_tensor_add_bias(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "tensor_add_bias", tensor_add_bias_native, make_fun_type(params, returns));
+}
+
+static ResultCode tensor_relu_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    if (IS_FOREIGN(t)) return foreign_argument();
+    materialize_tensor(t);
+    for (int i = 0; i < t->count; i++) {
+        if (t->data[i] < 0.0) t->data[i] = 0.0;
+    }
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode tensor_sigmoid_native(Value* args, struct ValueArray* returns) {
+    struct ObjTensor* t = args[0].as.tensor_type;
+    if (IS_FOREIGN(t)) return foreign_argument();
+    materialize_tensor(t);
+    for (int i = 0; i < t->count; i++) {
+        t->data[i] = 1.0 / (1.0 + exp(-t->data[i]));
+    }
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_activation(struct Compiler* compiler, const char* name, ResultCode (*function)(Value*, struct ValueArray*)) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_tensor_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, name, function, make_fun_type(params, returns));
+}
+
+
+
+/*
+ * Sets - the element arguments are checked against the Set element type (or Map key type for
+ * remove_key) in the compiler (see check_set_arguments), and set_union and set_intersection
+ * return the type of their arguments
+ */
+
+static ResultCode set_insert_native(Value* args, struct ValueArray* returns) {
+    if (IS_FOREIGN(args[0].as.set_type)) return foreign_argument();
+    Value element = args[1];
+    if (element.type == VAL_STRING) element = to_string(intern_in_place(element.as.string_type));
+    push_root(element);
+    set_value_entry(&args[0].as.set_type->table, element, to_nil());
+    pop_root();
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_set_insert(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_set_type(make_nil_type()));
+    add_type(params, make_nil_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "set_insert", set_insert_native, make_fun_type(params, returns));
+}
+
+//removes an element of a Set or a key of a Map
+static ResultCode remove_key_native(Value* args, struct ValueArray* returns) {
+    Value element = args[1];
+    if (element.type == VAL_STRING) element = to_string(flatten_string(element.as.string_type));
+    if (args[0].type == VAL_MAP) {
+        struct ObjMap* map = args[0].as.map_type;
+        if (IS_FOREIGN(map)) return foreign_argument();
+        push_root(element);
+        materialize_map(map);
+        pop_root();
+        delete_value_entry(&map->table, element);
+    } else {
+        struct ObjSet* set = args[0].as.set_type;
+        if (IS_FOREIGN(set)) return foreign_argument();
+        delete_value_entry(&set->table, element);
+    }
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_remove_key(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    struct Type* container_type = make_set_type(make_nil_type());
+    container_type->opt = make_map_type(make_nil_type(), make_nil_type());
+    add_type(params, container_type);
+    add_type(params, make_nil_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "remove_key", remove_key_native, make_fun_type(params, returns));
+}
+
+//elements of 'a', then the elements of 'b' not in 'a'
+static ResultCode set_union_native(Value* args, struct ValueArray* returns) {
+    struct ObjSet* b = args[1].as.set_type;
+    struct ObjSet* result = copy_set(args[0].as.set_type);
+    push_root(to_set(result));
+    reserve_value_table(&result->table, result->table.count + b->table.count);
+    for (int i = 0; i < b->table.entry_count; i++) {
+        Value element = b->table.entries[i].key;
+        if (element.type != VAL_NIL) set_value_entry(&result->table, element, to_nil());
+    }
+    add_value(returns, to_set(result));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+//elements of the smaller set that are also in the larger one
+static ResultCode set_intersection_native(Value* args, struct ValueArray* returns) {
+    struct ObjSet* small = args[0].as.set_type;
+    struct ObjSet* large = args[1].as.set_type;
+    if (small->table.count > large->table.count) {
+        struct ObjSet* swap = small;
+        small = large;
+        large = swap;
+    }
+
+    struct ObjSet* result = make_set();
+    push_root(to_set(result));
+    for (int i = 0; i < small->table.entry_count; i++) {
+        Value element = small->table.entries[i].key;
+        Value unused;
+        if (element.type != VAL_NIL && get_value_entry(&large->table, element, &unused)) {
+            set_value_entry(&result->table, element, to_nil());
+        }
+    }
+    add_value(returns, to_set(result));
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_set_operation(struct Compiler* compiler, const char* name, ResultCode (*function)(Value*, struct ValueArray*)) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_set_type(make_nil_type()));
+    add_type(params, make_set_type(make_nil_type()));
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_set_type(make_infer_type()));
+    return define_native(compiler, name, function, make_fun_type(params, returns));
+}
+
+
+
+/*
+ * Parallel map/reduce - the function and anything it captures are read by worker threads (see
+ * parallel.c), so the workers can't modify objects they didn't make or create closures
+ */
+
+static ResultCode parallel_map_native(Value* args, struct ValueArray* returns) {
+    Value result;
+    if (parallel_map(args[0].as.list_type, args[1], &result) == RESULT_FAILED) return RESULT_FAILED;
+    push_root(result);
+    add_value(returns, result);
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+//the return type is the List of whatever the function returns (see infer_return_type in compiler.c)
+static ResultCode define_parallel_map(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_list_type(make_nil_type()));
+    add_type(params, make_nil_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_list_type(make_infer_type()));
+    return define_native(compiler, "parallel_map", parallel_map_native, make_fun_type(params, returns));
+}
+
+//'fn' must be associative since the chunks of the List are folded separately
+static ResultCode parallel_reduce_native(Value* args, struct ValueArray* returns) {
+    Value result;
+    if (parallel_reduce(args[0].as.list_type, args[1], args[2], &result) == RESULT_FAILED) return RESULT_FAILED;
+    push_root(result);
+    add_value(returns, result);
+    pop_root();
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_parallel_reduce(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_list_type(make_nil_type()));
+    add_type(params, make_nil_type());
+    add_type(params, make_nil_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_infer_type());
+    return define_native(compiler, "parallel_reduce", parallel_reduce_native, make_fun_type(params, returns));
+}
+
+//0 (the default) for one worker per cpu
+static ResultCode set_worker_count_native(Value* args, struct ValueArray* returns) {
+    if (args[0].as.integer_type < 0) return RESULT_FAILED;
+    set_worker_count(args[0].as.integer_type);
+    add_value(returns, to_nil());
+    return RESULT_SUCCESS;
+}
+
+static ResultCode define_set_worker_count(struct Compiler* compiler) {
+    struct TypeArray* params = make_type_array();
+    add_type(params, make_int_type());
+    struct TypeArray* returns = make_type_array();
+    add_type(returns, make_nil_type());
+    return define_native(compiler, "set_worker_count", set_worker_count_native, make_fun_type(params, returns));
+}
+
 void define_native_functions(struct Compiler* compiler) {
     define_print(compiler);
     define_clock(compiler);
@@ -511,16 +1532,59 @@ void define_native_functions(struct Compiler* compiler) {
     define_open(compiler);
     define_read_all(compiler);
     define_read_bytes(compiler);
+    define_file_mmap(compiler);
+    define_open_with(compiler);
+    define_read_chunk(compiler);
+    define_write_bytes(compiler);
+    define_file_seek(compiler);
+    define_file_tell(compiler);
+    define_file_flush(compiler);
+    define_buffer_writes(compiler);
+    define_decode_int(compiler);
+    define_decode_float(compiler);
     define_close(compiler);
     define_read_line(compiler);
     define_eof(compiler);
     define_rewind(compiler);
     define_append(compiler);
     define_clear(compiler);
+    define_string_builder(compiler);
+    define_append_int(compiler);
+    define_append_float(compiler);
+    define_build_string(compiler);
     define_is_alpha(compiler);
     define_is_digit(compiler);
     define_random_uniform(compiler);
     define_exp(compiler);
+    define_vec_sum(compiler);
+    define_vec_dot(compiler);
+    define_vec_min(compiler);
+    define_vec_max(compiler);
+    define_vec_argmax(compiler);
+    define_vec_axpy(compiler);
+    define_vec_scale(compiler);
+    define_elements(compiler, "vec_add", vec_add_native);
+    define_elements(compiler, "vec_sub", vec_sub_native);
+    define_elements(compiler, "vec_mul", vec_mul_native);
+    define_elements(compiler, "vec_div", vec_div_native);
+    define_tensor_zeros(compiler);
+    define_to_tensor(compiler);
+    define_random_tensor(compiler);
+    define_tensor_values(compiler);
+    define_tensor_shape(compiler);
+    define_tensor_reshape(compiler);
+    define_tensor_transpose(compiler);
+    define_tensor_matmul(compiler);
+    define_tensor_add_bias(compiler);
+    define_activation(compiler, "tensor_relu", tensor_relu_native);
+    define_activation(compiler, "tensor_sigmoid", tensor_sigmoid_native);
+    define_set_insert(compiler);
+    define_remove_key(compiler);
+    define_set_operation(compiler, "set_union", set_union_native);
+    define_set_operation(compiler, "set_intersection", set_intersection_native);
+    define_parallel_map(compiler);
+    define_parallel_reduce(compiler);
+    define_set_worker_count(compiler);
 }
 
 
@@ -1,9 +1,18 @@
 #include <string.h>
+#include <limits.h>
 #include "obj.h"
 #include "memory.h"
 
+#ifdef MMAP_FILES
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 
 void insert_object(struct Obj* ptr) {
+    ptr->heap = mm.heap;
     if (mm.objects == NULL) {
         mm.objects = ptr;
         return; 
@@ -13,14 +22,29 @@ void insert_object(struct Obj* ptr) {
     mm.objects = ptr;
 }
 
+static int element_size(ListKind kind) {
+    switch (kind) {
+        case LIST_INT: return sizeof(int32_t);
+        case LIST_FLOAT: return sizeof(double);
+        case LIST_BYTE: return sizeof(uint8_t);
+        default: return sizeof(Value);
+    }
+}
+
+//first element of a list or list view
+static uint8_t* list_elements(struct ObjList* list) {
+    if (list->frozen == NULL) return (uint8_t*)list->data;
+    return (uint8_t*)list->frozen->data + list->offset * element_size(list->kind);
+}
 
 int free_object(struct Obj* obj) {
     int bytes_freed = 0;
     switch(obj->type) {
         case OBJ_STRING: {
             struct ObjString* obj_string = (struct ObjString*)obj;
-            bytes_freed += FREE_ARRAY(obj_string->chars, char, obj_string->length + 1);
-            bytes_freed += FREE(obj_string, struct ObjString);
+            //ropes don't carry their own chars
+            int char_count = obj_string->left == NULL ? obj_string->length : 0;
+            bytes_freed += free_mem(obj_string, STRING_SIZE(char_count));
             break;
         }
         case OBJ_FUNCTION: {
@@ -39,16 +63,19 @@ int free_object(struct Obj* obj) {
         }
         case OBJ_FILE: {
             struct ObjFile* file = (struct ObjFile*)obj;
-            if (file->fp != NULL)
+            if (file->fp != NULL) {
+                flush_file(file);
                 fclose(file->fp);
+            }
             file->fp = NULL;
+            bytes_freed += FREE_ARRAY(file->buffer, char, file->buffer_capacity);
+            bytes_freed += FREE_ARRAY(file->write_buffer, char, file->write_capacity);
             bytes_freed += FREE(file, struct ObjFile);
             break;
         }
         case OBJ_INSTANCE: {
             struct ObjInstance* oi = (struct ObjInstance*)obj;
-            bytes_freed += free_table(&oi->props);
-            bytes_freed += FREE(oi, struct ObjInstance);
+            bytes_freed += free_mem(oi, sizeof(struct ObjInstance) + table_bytes(&oi->props));
             break;
         }
         case OBJ_ENUM: {
@@ -69,16 +96,43 @@ int free_object(struct Obj* obj) {
         }
         case OBJ_LIST: {
             struct ObjList* list = (struct ObjList*)obj;
-            bytes_freed += free_value_array(&list->values);
+            bytes_freed += FREE_ARRAY(list->data, uint8_t, list->capacity * element_size(list->kind));
             bytes_freed += FREE(list, struct ObjList);
             break;
         }
         case OBJ_MAP: {
             struct ObjMap* map = (struct ObjMap*)obj;
-            bytes_freed += free_table(&map->table);
+            bytes_freed += free_value_table(&map->table);
             bytes_freed += FREE(map, struct ObjMap);
             break;
         }
+        case OBJ_SET: {
+            struct ObjSet* set = (struct ObjSet*)obj;
+            bytes_freed += free_value_table(&set->table);
+            bytes_freed += FREE(set, struct ObjSet);
+            break;
+        }
+        case OBJ_BYTES: {
+            struct ObjBytes* bytes = (struct ObjBytes*)obj;
+#ifdef MMAP_FILES
+            if (bytes->mapped) munmap((void*)bytes->data, bytes->length);
+#endif
+            if (bytes->source == NULL && !bytes->mapped) bytes_freed += FREE_ARRAY(bytes->data, uint8_t, bytes->length);
+            bytes_freed += FREE(bytes, struct ObjBytes);
+            break;
+        }
+        case OBJ_STRING_BUILDER: {
+            struct ObjStringBuilder* sb = (struct ObjStringBuilder*)obj;
+            bytes_freed += FREE_ARRAY(sb->chars, char, sb->capacity);
+            bytes_freed += FREE(sb, struct ObjStringBuilder);
+            break;
+        }
+        case OBJ_TENSOR: {
+            struct ObjTensor* tensor = (struct ObjTensor*)obj;
+            if (tensor->frozen == NULL) bytes_freed += FREE_ARRAY(tensor->data, double, tensor->count);
+            bytes_freed += FREE(tensor, struct ObjTensor);
+            break;
+        }
     }
     return bytes_freed;
 }
@@ -106,6 +160,14 @@ void print_object(struct Obj* obj) {
             printf("OBJ_FILE");
             break;
         }
+        case OBJ_STRING_BUILDER: {
+            printf("OBJ_STRING_BUILDER");
+            break;
+        }
+        case OBJ_TENSOR: {
+            printf("OBJ_TENSOR");
+            break;
+        }
         case OBJ_INSTANCE:
             printf("OBJ_INSTANCE: ");
             break;
@@ -128,6 +190,12 @@ void print_object(struct Obj* obj) {
         case OBJ_MAP:
             printf("OBJ_MAP:");
             break;
+        case OBJ_BYTES:
+            printf("OBJ_BYTES");
+            break;
+        case OBJ_SET:
+            printf("OBJ_SET:");
+            break;
         default:
             printf("Invalid Object: ");
             break;
@@ -145,12 +213,20 @@ void mark_object(struct Obj* obj) {
 }
 
 
-struct ObjFile* make_file(FILE* fp, struct ObjString* file_path) {
+struct ObjFile* make_file(FILE* fp, struct ObjString* file_path, const char* mode) {
     struct ObjFile* obj = ALLOCATE(struct ObjFile);
     obj->fp = fp;
     obj->file_path = file_path;
-    obj->next_line = NULL;
-    obj->is_eof = false;
+    strncpy(obj->mode, mode, sizeof(obj->mode) - 1);
+    obj->mode[sizeof(obj->mode) - 1] = '\0';
+    obj->buffer = NULL;
+    obj->buffer_start = 0;
+    obj->buffer_end = 0;
+    obj->buffer_capacity = 0;
+    obj->write_buffer = NULL;
+    obj->write_count = 0;
+    obj->write_capacity = 0;
+    obj->write_buffer_size = 0;
 
     obj->base.type = OBJ_FILE;
     obj->base.next = NULL;
@@ -160,6 +236,141 @@ struct ObjFile* make_file(FILE* fp, struct ObjString* file_path) {
     return obj;
 }
 
+#define FILE_BUFFER_SIZE (64 * 1024)
+//appends to unbuffered files are decoded in pieces of this size
+#define FILE_WRITE_CHUNK 4096
+
+//Writes any pending appends to the end of the file and flushes the stream.
+//Returns false if anything failed to be written
+bool flush_file(struct ObjFile* file) {
+    if (file->fp == NULL) return false;
+    bool written = true;
+    if (file->write_count > 0) {
+        written = fseek(file->fp, 0, SEEK_END) == 0 &&
+                  fwrite(file->write_buffer, sizeof(char), file->write_count, file->fp) == (size_t)file->write_count;
+        file->write_count = 0;
+    }
+    return fflush(file->fp) == 0 && written;
+}
+
+//appends are at the end of the file, so reads and seeks after them start from there
+static void flush_pending(struct ObjFile* file) {
+    if (file->write_count > 0) flush_file(file);
+}
+
+//Appends 'chars' to the end of the file through the write buffer.
+//'file' must be reachable by the GC since the write buffer is allocated on first use
+bool append_to_file(struct ObjFile* file, const char* chars, int length) {
+    if (file->fp == NULL) return false;
+    if (file->write_capacity == 0) {
+        int capacity = file->write_buffer_size > 0 ? file->write_buffer_size : FILE_WRITE_CHUNK;
+        file->write_buffer = GROW_ARRAY(file->write_buffer, char, capacity, 0);
+        file->write_capacity = capacity;
+    }
+    //the read position moves to the end of the file with the write
+    reset_file_buffer(file);
+
+    bool written = true;
+    int i = 0;
+    while (i < length) {
+        if (file->write_count == file->write_capacity) written = flush_file(file) && written;
+
+        int run = length - i;
+        int space = file->write_capacity - file->write_count;
+        if (run > space) run = space;
+        memcpy(file->write_buffer + file->write_count, chars + i, run);
+        file->write_count += run;
+        i += run;
+    }
+
+    if (file->write_buffer_size == 0) return flush_file(file) && written;
+    return written;
+}
+
+//Appends are kept until 'size' bytes are waiting, or written straight away if 'size' is 0
+bool set_file_write_buffer(struct ObjFile* file, int size) {
+    bool written = file->write_count == 0 || flush_file(file);
+    FREE_ARRAY(file->write_buffer, char, file->write_capacity);
+    file->write_buffer = NULL;
+    file->write_capacity = 0;
+    file->write_buffer_size = size;
+    return written;
+}
+
+//Moves any unread bytes to the front of the buffer and reads more of the file in after them.
+//The buffer doubles when a single line fills it, so lines can be any length.
+//Returns the number of bytes read - 0 at the end of the file.
+//'file' must be reachable by the GC since growing the buffer can trigger a collection
+static int fill_file_buffer(struct ObjFile* file) {
+    if (file->fp == NULL) return 0;
+    flush_pending(file);
+
+    int unread = file->buffer_end - file->buffer_start;
+    if (file->buffer_start > 0) {
+        memmove(file->buffer, file->buffer + file->buffer_start, unread);
+        file->buffer_start = 0;
+        file->buffer_end = unread;
+    }
+
+    if (unread == file->buffer_capacity) {
+        int new_capacity = file->buffer_capacity == 0 ? FILE_BUFFER_SIZE : file->buffer_capacity * 2;
+        file->buffer = GROW_ARRAY(file->buffer, char, new_capacity, file->buffer_capacity);
+        file->buffer_capacity = new_capacity;
+    }
+
+    //a request this large skips the stdio buffer and goes straight to read(2)
+    int bytes_read = (int)fread(file->buffer + file->buffer_end, sizeof(char), file->buffer_capacity - file->buffer_end, file->fp);
+    file->buffer_end += bytes_read;
+    return bytes_read;
+}
+
+//Returns the next line without its '\n', or the remaining bytes if the file does not end with one.
+//Lines are not interned - most are used once and thrown away.
+//Returns an empty string at the end of the file.
+struct ObjString* read_file_line(struct ObjFile* file) {
+    int scanned = 0;
+    char* newline = NULL;
+    while (true) {
+        int unread = file->buffer_end - file->buffer_start;
+        if (unread > scanned) {
+            newline = memchr(file->buffer + file->buffer_start + scanned, '\n', unread - scanned);
+            if (newline != NULL) break;
+        }
+        //only the bytes read in by the next fill need to be scanned
+        scanned = unread;
+        if (fill_file_buffer(file) == 0) break;
+    }
+
+    char* start = file->buffer + file->buffer_start;
+    int length = newline != NULL ? (int)(newline - start) : file->buffer_end - file->buffer_start;
+    file->buffer_start += newline != NULL ? length + 1 : length;
+    return make_transient_string(start, length);
+}
+
+bool at_file_end(struct ObjFile* file) {
+    return file->buffer_start == file->buffer_end && fill_file_buffer(file) == 0;
+}
+
+//Drops any buffered bytes, eg. after the file position is moved or the file is written to
+void reset_file_buffer(struct ObjFile* file) {
+    file->buffer_start = 0;
+    file->buffer_end = 0;
+}
+
+//The offset the next read starts at.  'fp' is ahead of it by the bytes still in the buffer.
+//Returns -1 on failure
+long file_position(struct ObjFile* file) {
+    flush_pending(file);
+    long position = ftell(file->fp);
+    return position == -1L ? -1L : position - (file->buffer_end - file->buffer_start);
+}
+
+bool seek_file(struct ObjFile* file, long position) {
+    flush_pending(file);
+    reset_file_buffer(file);
+    return fseek(file->fp, position, SEEK_SET) == 0;
+}
+
 struct ObjStruct* make_struct(struct ObjString* name, struct ObjStruct* super) {
     struct ObjStruct* obj = ALLOCATE(struct ObjStruct);
     push_root(to_struct(obj));
@@ -171,20 +382,42 @@ struct ObjStruct* make_struct(struct ObjString* name, struct ObjStruct* super) {
 
     obj->name = name;
     obj->super = super;
+    obj->container_count = 0;
     init_table(&obj->props);
 
     pop_root();
     return obj;
 }
 
-struct ObjInstance* make_instance(struct Table table, struct ObjStruct* klass) {
-    struct ObjInstance* obj = ALLOCATE(struct ObjInstance);
+//Defaults of these types are objects that can be modified in place, so each instance gets its own copy
+bool copied_per_instance(Value value) {
+    return value.type == VAL_LIST || value.type == VAL_MAP || value.type == VAL_SET ||
+           value.type == VAL_STRING_BUILDER || value.type == VAL_TENSOR;
+}
+
+//Copies the props of 'klass' (entries and control bytes in one go) into the instance's own
+//allocation.  Primitive and string defaults are used as is, the others are copied (see copied_per_instance).
+//'klass' must be reachable by the GC.
+struct ObjInstance* make_instance(struct ObjStruct* klass) {
+    size_t size = sizeof(struct ObjInstance) + table_bytes(&klass->props);
+    struct ObjInstance* obj = (struct ObjInstance*)realloc_mem(NULL, size, 0);
     obj->base.type = OBJ_INSTANCE;
     obj->base.next = NULL;
     obj->base.is_marked = false;
-    insert_object((struct Obj*)obj);
-    obj->props = table;
+    copy_table_into(&obj->props, &klass->props, obj + 1);
     obj->klass = klass;
+    insert_object((struct Obj*)obj);
+
+    if (klass->container_count == 0) return obj;
+
+    push_root(to_instance(obj));
+    for (int i = 0; i < obj->props.entry_count; i++) {
+        struct Entry* entry = &obj->props.entries[i];
+        if (copied_per_instance(entry->value)) {
+            entry->value = copy_value(&entry->value);
+        }
+    }
+    pop_root();
 
     return obj;
 }
@@ -253,39 +486,198 @@ struct ObjNative* make_native(struct ObjString* name, ResultCode (*function)(Val
     return obj;
 }
 
-struct ObjList* make_list(void) {
+struct ObjList* make_list(ListKind kind) {
     struct ObjList* obj = ALLOCATE(struct ObjList);
     push_root(to_list(obj));
     obj->base.type = OBJ_LIST;
     obj->base.next = NULL;
     obj->base.is_marked = false;
+    obj->kind = kind;
+    obj->data = NULL;
+    obj->count = 0;
+    obj->capacity = 0;
+    obj->frozen = NULL;
+    obj->offset = 0;
     insert_object((struct Obj*)obj);
 
-    init_value_array(&obj->values);
-
     pop_root();
     return obj;
 }
 
-/*
+//slices shorter than this are copied since freezing the sliced list isn't free
+#define LIST_VIEW_MIN_LENGTH 16
+
+//'list' must be reachable by the GC
+struct ObjList* make_list_slice(struct ObjList* list, int start, int end) {
+    struct ObjList* slice = make_list(list->kind);
+    push_root(to_list(slice));
+
+    //freezing a list makes its next write copy all of it, so a slice of less than half of an
+    //unshared list is copied instead (lists that are already shared can be sliced for free)
+    int length = end - start;
+    bool unshared = list->frozen == NULL && !IS_FOREIGN(list);
+    if (length < LIST_VIEW_MIN_LENGTH || (unshared && length * 2 < list->count)) {
+        reserve_list(slice, length);
+        int size = element_size(list->kind);
+        memcpy(slice->data, list_elements(list) + start * size, length * size);
+        slice->count = length;
+        pop_root();
+        return slice;
+    }
+
+    //a list on another heap can't be modified while the slice is alive, so
+    //it can be shared as is
+    if (list->frozen == NULL && IS_FOREIGN(list)) {
+        slice->frozen = list;
+        slice->offset = start;
+        slice->count = end - start;
+        pop_root();
+        return slice;
+    }
+
+    //move the elements into a frozen list and make 'list' a view of all of them
+    if (list->frozen == NULL) {
+        struct ObjList* frozen = make_list(list->kind);
+        frozen->data = list->data;
+        frozen->count = list->count;
+        frozen->capacity = list->capacity;
+        list->frozen = frozen;
+        list->offset = 0;
+        list->data = NULL;
+        list->capacity = 0;
+    }
+
+    slice->frozen = list->frozen;
+    slice->offset = list->offset + start;
+    slice->count = length;
+
+    pop_root();
+    return slice;
+}
+
+//Gives a view its own copy of its elements so that it can be modified
+//'list' must be reachable by the GC
+void materialize_list(struct ObjList* list) {
+    if (list->frozen == NULL) return;
+
+    int size = element_size(list->kind);
+    //the view keeps 'frozen' alive while the new array is allocated
+    uint8_t* data = GROW_ARRAY(NULL, uint8_t, list->count * size, 0);
+    memcpy(data, list_elements(list), list->count * size);
+
+    list->data = data;
+    list->capacity = list->count;
+    list->frozen = NULL;
+    list->offset = 0;
+}
+
+//'list' must be reachable by the GC
+void reserve_list(struct ObjList* list, int capacity) {
+    materialize_list(list);
+    if (capacity <= list->capacity) return;
+
+    int size = element_size(list->kind);
+    list->data = GROW_ARRAY(list->data, uint8_t, capacity * size, list->capacity * size);
+    list->capacity = capacity;
+}
+
+Value list_get(struct ObjList* list, int idx) {
+    switch (list->kind) {
+        case LIST_INT: return to_integer(LIST_DATA(list, int32_t)[idx]);
+        case LIST_FLOAT: return to_float(LIST_DATA(list, double)[idx]);
+        case LIST_BYTE: return to_byte(LIST_DATA(list, uint8_t)[idx]);
+        default: return LIST_VALUES(list)[idx];
+    }
+}
+
+static bool fits_list(struct ObjList* list, Value value) {
+    switch (list->kind) {
+        case LIST_INT: return value.type == VAL_INT;
+        case LIST_FLOAT: return value.type == VAL_FLOAT;
+        case LIST_BYTE: return value.type == VAL_BYTE;
+        default: return true;
+    }
+}
+
+//Boxes the elements of a packed list so that it can hold 'value' (eg, a nil)
+//'list' must be reachable by the GC
+static void box_list(struct ObjList* list) {
+    materialize_list(list);
+    int capacity = list->capacity < 8 ? 8 : list->capacity;
+    Value* values = GROW_ARRAY(NULL, Value, capacity, 0);
+    for (int i = 0; i < list->count; i++) {
+        values[i] = list_get(list, i);
+    }
+
+    FREE_ARRAY(list->data, uint8_t, list->capacity * element_size(list->kind));
+    list->kind = LIST_BOXED;
+    list->data = values;
+    list->capacity = capacity;
+}
+
+//'list' must be reachable by the GC
+void list_set(struct ObjList* list, int idx, Value value) {
+    materialize_list(list);
+    if (!fits_list(list, value)) box_list(list);
+
+    switch (list->kind) {
+        case LIST_INT: LIST_DATA(list, int32_t)[idx] = value.as.integer_type; break;
+        case LIST_FLOAT: LIST_DATA(list, double)[idx] = value.as.float_type; break;
+        case LIST_BYTE: LIST_DATA(list, uint8_t)[idx] = value.as.byte_type; break;
+        default: LIST_VALUES(list)[idx] = value; break;
+    }
+}
+
+//'list' must be reachable by the GC
+void list_append(struct ObjList* list, Value value) {
+    materialize_list(list);
+    if (!fits_list(list, value)) box_list(list);
+
+    if (list->count + 1 > list->capacity) {
+        reserve_list(list, list->capacity == 0 ? 8 : list->capacity * 2);
+    }
+
+    list->count++;
+    list_set(list, list->count - 1, value);
+}
+
+static bool is_container(Value value) {
+    return value.type == VAL_LIST || value.type == VAL_MAP || value.type == VAL_SET;
+}
+
+//Copies share their elements with 'l' until either one is modified, unless 'l' holds
+//lists or maps (which need copying themselves) or is on another heap.
+//'l' must be reachable by the GC
 struct ObjList* copy_list(struct ObjList* l) {
-    struct ObjList* obj = ALLOCATE(struct ObjList);
-    push_root(to_list(obj));
-    obj->base.type = OBJ_LIST;
-    obj->base.next = NULL;
-    obj->base.is_marked = false;
-    obj->default_value = to_nil();
-    insert_object((struct Obj*)obj);
+    bool shareable = !IS_FOREIGN(l);
+    if (shareable && l->kind == LIST_BOXED) {
+        for (int i = 0; i < l->count; i++) {
+            if (is_container(LIST_VALUES(l)[i])) {
+                shareable = false;
+                break;
+            }
+        }
+    }
+    if (shareable) return make_list_slice(l, 0, l->count);
 
-    init_value_array(&obj->values);
+    struct ObjList* list = make_list(l->kind);
+    push_root(to_list(list));
+    reserve_list(list, l->count);
 
-    for (int i = 0; i < l->values.count; i++) {
-        add_value(&obj->values, copy_value(&l->values.values[i]));
+    if (l->kind == LIST_BOXED) {
+        //copying an element may collect garbage, so only count the initialized ones
+        for (int i = 0; i < l->count; i++) {
+            LIST_VALUES(list)[i] = copy_value(&LIST_VALUES(l)[i]);
+            list->count++;
+        }
+    } else {
+        memcpy(list->data, list_elements(l), l->count * element_size(l->kind));
+        list->count = l->count;
     }
 
     pop_root();
-    return obj;
-}*/
+    return list;
+}
 
 struct ObjMap* make_map(void) {
     struct ObjMap* obj = ALLOCATE(struct ObjMap);
@@ -295,12 +687,381 @@ struct ObjMap* make_map(void) {
     obj->base.is_marked = false;
     insert_object((struct Obj*)obj);
 
-    init_table(&obj->table);
+    init_value_table(&obj->table);
+    obj->frozen = NULL;
+
+    pop_root();
+    return obj;
+}
+
+//Copies share their entries with 'map' until either one is modified (see copy_list).
+//'map' must be reachable by the GC
+struct ObjMap* copy_map(struct ObjMap* map) {
+    struct ValueTable* table = MAP_TABLE(map);
+    bool shareable = !IS_FOREIGN(map);
+    for (int i = 0; shareable && i < table->entry_count; i++) {
+        if (table->entries[i].key.type != VAL_NIL && is_container(table->entries[i].value)) shareable = false;
+    }
+
+    struct ObjMap* copy = make_map();
+    if (!shareable) {
+        push_root(to_map(copy));
+        copy_value_table(&copy->table, table);
+        pop_root();
+        return copy;
+    }
+
+    //move the entries into a frozen map and make 'map' a view of them too
+    if (map->frozen == NULL) {
+        push_root(to_map(copy));
+        struct ObjMap* frozen = make_map();
+        frozen->table = map->table;
+        init_value_table(&map->table);
+        map->frozen = frozen;
+        pop_root();
+    }
+
+    copy->frozen = map->frozen;
+    return copy;
+}
+
+//Gives a view its own copy of the entries so that it can be modified
+//'map' must be reachable by the GC
+void materialize_map(struct ObjMap* map) {
+    if (map->frozen == NULL) return;
+
+    //the view keeps 'frozen' alive while the new table is allocated
+    clone_value_table(&map->table, &map->frozen->table);
+    map->frozen = NULL;
+}
+
+struct ObjSet* make_set(void) {
+    struct ObjSet* obj = ALLOCATE(struct ObjSet);
+    obj->base.type = OBJ_SET;
+    obj->base.next = NULL;
+    obj->base.is_marked = false;
+    init_value_table(&obj->table);
+    insert_object((struct Obj*)obj);
+    return obj;
+}
 
+//Elements are strings or primitives, so they are shared as is - except strings from another
+//heap, which are copied onto this one.
+//'set' must be reachable by the GC
+struct ObjSet* copy_set(struct ObjSet* set) {
+    struct ObjSet* copy = make_set();
+    push_root(to_set(copy));
+    if (!IS_FOREIGN(set)) {
+        clone_value_table(&copy->table, &set->table);
+    } else {
+        reserve_value_table(&copy->table, set->table.count);
+        for (int i = 0; i < set->table.entry_count; i++) {
+            Value element = set->table.entries[i].key;
+            if (element.type == VAL_NIL) continue;
+            if (element.type == VAL_STRING) {
+                struct ObjString* str = element.as.string_type;
+                element = to_string(make_string(STRING_CHARS(str), str->length));
+            }
+            push_root(element);
+            set_value_entry(&copy->table, element, to_nil());
+            pop_root();
+        }
+    }
     pop_root();
+    return copy;
+}
+
+static struct ObjBytes* allocate_bytes(void) {
+    struct ObjBytes* obj = ALLOCATE(struct ObjBytes);
+    obj->base.type = OBJ_BYTES;
+    obj->base.next = NULL;
+    obj->base.is_marked = false;
+    obj->data = NULL;
+    obj->length = 0;
+    obj->mapped = false;
+    obj->source = NULL;
+    insert_object((struct Obj*)obj);
     return obj;
 }
 
+//Maps the whole file at 'path' into memory read-only, or returns NULL if it can't be read.
+//Pages are read in by the OS as they are first touched.
+struct ObjBytes* map_file(const char* path) {
+#ifdef MMAP_FILES
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size > INT_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    //an empty file can't be mapped, and doesn't need to be
+    void* data = NULL;
+    if (st.st_size > 0) {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+    }
+    //the mapping stays valid after the file is closed
+    close(fd);
+
+    struct ObjBytes* obj = allocate_bytes();
+    obj->data = data;
+    obj->length = (int)st.st_size;
+    obj->mapped = data != NULL;
+    return obj;
+#else
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+
+    long file_size;
+    if (fseek(fp, 0L, SEEK_END) != 0 || (file_size = ftell(fp)) == -1L || file_size > INT_MAX) {
+        fclose(fp);
+        return NULL;
+    }
+    rewind(fp);
+
+    struct ObjBytes* obj = allocate_bytes();
+    push_root(to_bytes(obj));
+    uint8_t* data = GROW_ARRAY(NULL, uint8_t, file_size, 0);
+    obj->data = data;
+    obj->length = (int)file_size;
+    long bytes_read = (long)fread(data, sizeof(uint8_t), file_size, fp);
+    fclose(fp);
+    pop_root();
+    return bytes_read == file_size ? obj : NULL;
+#endif
+}
+
+//Reads up to 'count' bytes from the current position of 'file' into a new Bytes, starting
+//with any bytes already in the line buffer.  Fewer bytes are read at the end of the file.
+//The array grows as bytes arrive, so a large 'count' near the end of the file doesn't
+//allocate bytes that are never read.
+//'file' must be reachable by the GC
+struct ObjBytes* read_file_bytes(struct ObjFile* file, int count) {
+    int length = file->buffer_end - file->buffer_start;
+    if (length > count) length = count;
+    int capacity = count < FILE_BUFFER_SIZE ? count : FILE_BUFFER_SIZE;
+    if (capacity < length) capacity = length;
+
+    struct ObjBytes* obj = allocate_bytes();
+    push_root(to_bytes(obj));
+    obj->data = GROW_ARRAY(NULL, uint8_t, capacity, 0);
+    obj->length = capacity;
+
+    if (length > 0) {
+        memcpy((uint8_t*)obj->data, file->buffer + file->buffer_start, length);
+        file->buffer_start += length;
+    }
+    if (length < count && file->fp != NULL) {
+        flush_pending(file);
+        while (length < count) {
+            if (length == capacity) {
+                int new_capacity = capacity > count / 2 ? count : capacity * 2;
+                obj->data = GROW_ARRAY((uint8_t*)obj->data, uint8_t, new_capacity, capacity);
+                obj->length = capacity = new_capacity;
+            }
+            int wanted = capacity - length;
+            int read = (int)fread((uint8_t*)obj->data + length, sizeof(uint8_t), wanted, file->fp);
+            length += read;
+            if (read < wanted) break;
+        }
+    }
+
+    if (length < capacity) {
+        obj->data = GROW_ARRAY((uint8_t*)obj->data, uint8_t, length, capacity);
+        obj->length = length;
+    }
+    pop_root();
+    return obj;
+}
+
+//'bytes' must be reachable by the GC
+struct ObjBytes* make_bytes_slice(struct ObjBytes* bytes, int start, int end) {
+    struct ObjBytes* obj = allocate_bytes();
+    obj->data = bytes->data + start;
+    obj->length = end - start;
+    obj->source = bytes->source != NULL ? bytes->source : bytes;
+    return obj;
+}
+
+//Copies the data of 'bytes' into a buffer owned by the copy, eg. to move Bytes made
+//by a parallel worker onto the main heap.
+//'bytes' must be reachable by the GC
+struct ObjBytes* copy_bytes(struct ObjBytes* bytes) {
+    struct ObjBytes* obj = allocate_bytes();
+    push_root(to_bytes(obj));
+    uint8_t* data = GROW_ARRAY(NULL, uint8_t, bytes->length, 0);
+    memcpy(data, bytes->data, bytes->length);
+    obj->data = data;
+    obj->length = bytes->length;
+    pop_root();
+    return obj;
+}
+
+static void set_row_major_strides(struct ObjTensor* tensor) {
+    int stride = 1;
+    for (int i = tensor->rank - 1; i >= 0; i--) {
+        tensor->strides[i] = stride;
+        stride *= tensor->shape[i];
+    }
+}
+
+//zero filled
+struct ObjTensor* make_tensor(int rank, const int* shape) {
+    struct ObjTensor* obj = ALLOCATE(struct ObjTensor);
+    push_root(to_tensor(obj));
+    obj->base.type = OBJ_TENSOR;
+    obj->base.next = NULL;
+    obj->base.is_marked = false;
+    obj->data = NULL;
+    obj->count = 0;
+    obj->rank = rank;
+    obj->frozen = NULL;
+    insert_object((struct Obj*)obj);
+
+    int count = 1;
+    for (int i = 0; i < rank; i++) {
+        obj->shape[i] = shape[i];
+        count *= shape[i];
+    }
+    set_row_major_strides(obj);
+
+    obj->data = GROW_ARRAY(NULL, double, count, 0);
+    memset(obj->data, 0, sizeof(double) * count);
+    obj->count = count;
+
+    pop_root();
+    return obj;
+}
+
+//The data of 'tensor' is frozen so that it can be shared with the view (tensors on another
+//heap are already read-only and are shared as is)
+//'tensor' must be reachable by the GC
+struct ObjTensor* make_tensor_view(struct ObjTensor* tensor, int rank, const int* shape, const int* strides) {
+    struct ObjTensor* frozen = tensor->frozen;
+    if (frozen == NULL && IS_FOREIGN(tensor)) {
+        frozen = tensor;
+    } else if (frozen == NULL) {
+        frozen = ALLOCATE(struct ObjTensor);
+        *frozen = *tensor;
+        frozen->base.next = NULL;
+        frozen->base.is_marked = false;
+        insert_object((struct Obj*)frozen);
+        tensor->frozen = frozen;
+        tensor->data = NULL;
+    }
+
+    struct ObjTensor* obj = ALLOCATE(struct ObjTensor);
+    *obj = *tensor;
+    obj->base.next = NULL;
+    obj->base.is_marked = false;
+    obj->data = NULL;
+    obj->frozen = frozen;
+    obj->rank = rank;
+    for (int i = 0; i < rank; i++) {
+        obj->shape[i] = shape[i];
+        obj->strides[i] = strides[i];
+    }
+    insert_object((struct Obj*)obj);
+    return obj;
+}
+
+bool tensor_is_contiguous(struct ObjTensor* tensor) {
+    int stride = 1;
+    for (int i = tensor->rank - 1; i >= 0; i--) {
+        if (tensor->shape[i] != 1 && tensor->strides[i] != stride) return false;
+        stride *= tensor->shape[i];
+    }
+    return true;
+}
+
+//copies the elements of 'tensor' into 'dst' in row-major order
+static void gather_tensor(struct ObjTensor* tensor, double* dst) {
+    const double* src = TENSOR_DATA(tensor);
+    int idx[TENSOR_MAX_RANK] = {0};
+    for (int i = 0; i < tensor->count; i++) {
+        int offset = 0;
+        for (int d = 0; d < tensor->rank; d++) offset += idx[d] * tensor->strides[d];
+        dst[i] = src[offset];
+        for (int d = tensor->rank - 1; d >= 0; d--) {
+            if (++idx[d] < tensor->shape[d]) break;
+            idx[d] = 0;
+        }
+    }
+}
+
+//Gives a view its own row-major copy of its elements so that it can be modified
+//'tensor' must be reachable by the GC
+void materialize_tensor(struct ObjTensor* tensor) {
+    if (tensor->frozen == NULL) return;
+
+    //the view keeps 'frozen' alive while the new buffer is allocated
+    double* data = GROW_ARRAY(NULL, double, tensor->count, 0);
+    gather_tensor(tensor, data);
+
+    tensor->data = data;
+    tensor->frozen = NULL;
+    set_row_major_strides(tensor);
+}
+
+//Row-major copy of 'tensor' (which is left as is, eg. when it is on another heap)
+//'tensor' must be reachable by the GC
+struct ObjTensor* copy_tensor(struct ObjTensor* tensor) {
+    struct ObjTensor* copy = make_tensor(tensor->rank, tensor->shape);
+    gather_tensor(tensor, copy->data);
+    return copy;
+}
+
+//'sb' must be reachable by the GC
+struct ObjStringBuilder* copy_string_builder(struct ObjStringBuilder* sb) {
+    struct ObjStringBuilder* copy = make_string_builder();
+    push_root(to_string_builder(copy));
+    append_to_string_builder(copy, sb->chars, sb->length);
+    pop_root();
+    return copy;
+}
+
+struct ObjStringBuilder* make_string_builder(void) {
+    struct ObjStringBuilder* obj = ALLOCATE(struct ObjStringBuilder);
+    push_root(to_string_builder(obj));
+    obj->base.type = OBJ_STRING_BUILDER;
+    obj->base.next = NULL;
+    obj->base.is_marked = false;
+    obj->chars = NULL;
+    obj->length = 0;
+    obj->capacity = 0;
+    insert_object((struct Obj*)obj);
+
+    obj->chars = GROW_ARRAY(obj->chars, char, 16, 0);
+    obj->capacity = 16;
+    obj->chars[0] = '\0';
+
+    pop_root();
+    return obj;
+}
+
+//'sb' must be reachable by the GC since growing the buffer can trigger a collection
+void append_to_string_builder(struct ObjStringBuilder* sb, const char* chars, int length) {
+    if (sb->length + length + 1 > sb->capacity) {
+        //appending a builder to itself - 'chars' moves with the buffer
+        bool self = chars == sb->chars;
+        int new_capacity = sb->capacity * 2;
+        while (new_capacity < sb->length + length + 1) new_capacity *= 2;
+        sb->chars = GROW_ARRAY(sb->chars, char, new_capacity, sb->capacity);
+        sb->capacity = new_capacity;
+        if (self) chars = sb->chars;
+    }
+
+    memcpy(sb->chars + sb->length, chars, length);
+    sb->length += length;
+    sb->chars[sb->length] = '\0';
+}
+
 static uint32_t hash_string(const char* str, int length) {
     uint32_t hash = 2166136261u;
     for (int i = 0; i < length; i++) {
@@ -310,39 +1071,244 @@ static uint32_t hash_string(const char* str, int length) {
     return hash;
 }
 
-struct ObjString* take_string(char* chars, int length) {
-    struct ObjString* interned = find_interned_string(&mm.vm->strings, chars, length, hash_string(chars, length));
-    if (interned != NULL) {
-        FREE_ARRAY(chars, char, length + 1);
-        return interned;
-    }
-
-    struct ObjString* obj = ALLOCATE(struct ObjString);
+//Allocates a string object with room for 'length' chars that is not yet tracked by the GC.
+//The caller fills in 'chars' and must then pass it to intern_string() or track_string().
+struct ObjString* allocate_string(int length) {
+    struct ObjString* obj = (struct ObjString*)realloc_mem(NULL, STRING_SIZE(length), 0);
 
     obj->base.type = OBJ_STRING;
     obj->base.next = NULL;
     obj->base.is_marked = false;
+    obj->base.heap = mm.heap;
 
-    obj->chars = chars;
     obj->length = length;
-    obj->hash = hash_string(chars, length);
+    obj->hash = 0;
+    obj->is_hashed = false;
+    obj->is_interned = false;
+    obj->left = NULL;
+    obj->right = NULL;
+    obj->offset = 0;
+    obj->chars[length] = '\0';
 
+    return obj;
+}
+
+static struct ObjString* insert_string(struct ObjString* obj, uint32_t hash) {
+    obj->hash = hash;
+    obj->is_hashed = true;
+    obj->is_interned = true;
     insert_object((struct Obj*)obj);
 
     push_root(to_string(obj));
-    set_entry(&mm.vm->strings, obj, to_nil());  //TODO uncomment this (along with the find_interned_strings checks) to intern strings
+    set_entry(&mm.vm->strings, obj, to_nil());
     pop_root();
     return obj;
 }
 
+//Returns the interned copy of 'str' if one exists (freeing 'str'), otherwise interns 'str'
+struct ObjString* intern_string(struct ObjString* str) {
+    if (mm.heap != MAIN_HEAP) return track_string(str);
+
+    uint32_t hash = hash_string(str->chars, str->length);
+    struct ObjString* interned = find_interned_string(&mm.vm->strings, str->chars, str->length, hash);
+    if (interned != NULL) {
+        free_mem(str, STRING_SIZE(str->length));
+        return interned;
+    }
+
+    return insert_string(str, hash);
+}
+
+//Hands a string from allocate_string() to the GC without hashing or interning it
+struct ObjString* track_string(struct ObjString* str) {
+    insert_object((struct Obj*)str);
+    return str;
+}
+
+struct ObjString* make_transient_string(const char* start, int length) {
+    struct ObjString* obj = allocate_string(length);
+    memcpy(obj->chars, start, length);
+    return track_string(obj);
+}
+
+//Interns an existing string object, eg. before it is used as a map key.
+//Returns the already interned equal string if there is one.
+//'str' must be reachable by the GC.
+//
+//Strings are only interned on the main heap - interning on a worker heap would give
+//two interned copies of the same string, and same_string() relies on there being one.
+struct ObjString* intern_in_place(struct ObjString* str) {
+    str = materialize_string(str);
+    if (str->is_interned || mm.heap != MAIN_HEAP) return str;
+
+    uint32_t hash = string_hash(str);
+    struct ObjString* interned = find_interned_string(&mm.vm->strings, str->chars, str->length, hash);
+    if (interned != NULL) return interned;
+
+    str->is_interned = true;
+    push_root(to_string(str));
+    set_entry(&mm.vm->strings, str, to_nil());
+    pop_root();
+    return str;
+}
+
+//'str' must be flat or a view
+uint32_t string_hash(struct ObjString* str) {
+    if (!str->is_hashed) {
+        if (IS_FOREIGN(str)) return hash_string(STRING_CHARS(str), str->length);
+        str->hash = hash_string(STRING_CHARS(str), str->length);
+        str->is_hashed = true;
+    }
+    return str->hash;
+}
+
+//both strings must be flat or views
+bool same_string(struct ObjString* a, struct ObjString* b) {
+    if (a == b) return true;
+    if (a->is_interned && b->is_interned) return false;
+    if (a->length != b->length) return false;
+    if (a->is_hashed && b->is_hashed && a->hash != b->hash) return false;
+    return memcmp(STRING_CHARS(a), STRING_CHARS(b), a->length) == 0;
+}
+
+//longer strings are rarely looked up again, so skip hashing them unless they become map keys
+#define INTERN_MAX_LENGTH 256
+
 struct ObjString* make_string(const char* start, int length) {
-    struct ObjString* interned = find_interned_string(&mm.vm->strings, start, length, hash_string(start, length));
+    if (length > INTERN_MAX_LENGTH || mm.heap != MAIN_HEAP) return make_transient_string(start, length);
+
+    uint32_t hash = hash_string(start, length);
+    struct ObjString* interned = find_interned_string(&mm.vm->strings, start, length, hash);
     if (interned != NULL) return interned;
 
-    char* chars = ALLOCATE_ARRAY(char);
-    chars = GROW_ARRAY(chars, char, length + 1, 0);
-    memcpy(chars, start, length);
-    chars[length] = '\0';
+    struct ObjString* obj = allocate_string(length);
+    memcpy(obj->chars, start, length);
+
+    return insert_string(obj, hash);
+}
+
+//concatenations shorter than this are copied right away since a rope node isn't any cheaper
+#define ROPE_MIN_LENGTH 64
+
+//'left' and 'right' must be reachable by the GC (eg, on the VM stack)
+struct ObjString* concat_strings(struct ObjString* left, struct ObjString* right) {
+    //skip over flattened ropes so that chains of forwarding nodes don't build up
+    if (left->left != NULL && left->right == NULL && left->length == left->left->length) left = left->left;
+    if (right->left != NULL && right->right == NULL && right->length == right->left->length) right = right->left;
+
+    int length = left->length + right->length;
+    if (length < ROPE_MIN_LENGTH) {
+        //both halves are flat or views since ropes are never shorter than ROPE_MIN_LENGTH
+        struct ObjString* concat = allocate_string(length);
+        memcpy(concat->chars, STRING_CHARS(left), left->length);
+        memcpy(concat->chars + left->length, STRING_CHARS(right), right->length);
+        return track_string(concat);
+    }
+
+    struct ObjString* rope = allocate_string(0);
+    rope->length = length;
+    rope->left = left;
+    rope->right = right;
+    insert_object((struct Obj*)rope);
+    return rope;
+}
+
+//Returns a flat string or a view with the same contents as 'str', flattening ropes.
+//Ropes on another heap are read-only, so they are copied instead.
+//'str' must be reachable by the GC.
+struct ObjString* flatten_string(struct ObjString* str) {
+    if (str->left == NULL) return str;
+    if (str->right == NULL) {
+        if (str->length == str->left->length) return str->left;
+        return str;
+    }
+
+    push_root(to_string(str));
+    struct ObjString* flat = allocate_string(str->length);
+
+    //copy leaves from the back - pushing left before right keeps the stack
+    //shallow for ropes built by appending in a loop (the common case)
+    //NOTE: using system realloc since no GC objects are allocated during the walk
+    int capacity = 64;
+    int count = 0;
+    struct ObjString** stack = (struct ObjString**)malloc(sizeof(struct ObjString*) * capacity);
+    if (stack == NULL) {
+        fprintf(stderr, "malloc");
+        exit(1);
+    }
+
+    int end = str->length;
+    stack[count++] = str;
+    while (count > 0) {
+        struct ObjString* node = stack[--count];
 
-    return take_string(chars, length);
+        if (node->right == NULL) {
+            end -= node->length;
+            memcpy(flat->chars + end, STRING_CHARS(node), node->length);
+            continue;
+        }
+
+        if (count + 2 > capacity) {
+            capacity *= 2;
+            stack = (struct ObjString**)realloc((void*)stack, sizeof(struct ObjString*) * capacity);
+            if (stack == NULL) {
+                fprintf(stderr, "realloc");
+                exit(1);
+            }
+        }
+        stack[count++] = node->left;
+        stack[count++] = node->right;
+    }
+    free((void*)stack);
+
+    track_string(flat);
+    if (!IS_FOREIGN(str)) {
+        str->left = flat;
+        str->right = NULL;
+        str->offset = 0;
+    }
+    pop_root();
+    return flat;
+}
+
+//Returns a flat, null terminated string with the same contents as 'str'.  Views are
+//copied (and then refer to the copy, so the string they were sliced from can be freed,
+//unless the view is on another heap).
+//'str' must be reachable by the GC.
+struct ObjString* materialize_string(struct ObjString* str) {
+    str = flatten_string(str);
+    if (str->left == NULL) return str;
+
+    push_root(to_string(str));
+    struct ObjString* flat = allocate_string(str->length);
+    memcpy(flat->chars, STRING_CHARS(str), str->length);
+    track_string(flat);
+    if (!IS_FOREIGN(str)) {
+        str->left = flat;
+        str->offset = 0;
+    }
+    pop_root();
+    return flat;
+}
+
+//Slices [start, start + length) out of a flat string or view without copying.
+//Empty and single character slices come from the interned strings instead.
+struct ObjString* make_string_view(struct ObjString* str, int start, int length) {
+    if (length == 0) return make_string("", 0);
+    if (length == 1) return mm.vm->single_chars[(uint8_t)STRING_CHARS(str)[start]];
+    if (str->left == NULL && start == 0 && length == str->length) return str;
+
+    if (str->left != NULL) {
+        start += str->offset;
+        str = str->left;
+    }
+
+    push_root(to_string(str));
+    struct ObjString* view = allocate_string(0);
+    view->length = length;
+    view->left = str;
+    view->offset = start;
+    track_string(view);
+    pop_root();
+    return view;
 }
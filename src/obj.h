@@ -19,37 +19,86 @@ typedef enum {
     OBJ_LIST,
     OBJ_MAP,
     OBJ_ENUM,
-    OBJ_FILE
+    OBJ_FILE,
+    OBJ_STRING_BUILDER,
+    OBJ_TENSOR,
+    OBJ_SET,
+    OBJ_BYTES
 } ObjType;
 
 struct Obj {
     ObjType type;
     struct Obj* next;
     bool is_marked;
+    uint8_t heap; //heap of the thread that made the object (see memory.h)
 };
 
 struct ObjFile {
     struct Obj base;
     FILE* fp;
     struct ObjString* file_path;
-    struct ObjString* next_line;
-    bool is_eof;
+    char mode[4]; //the fopen mode the file was opened with, eg. "a+" or "rb"
+    //lines are scanned out of this buffer - bytes in [buffer_start, buffer_end) are read but not yet returned
+    char* buffer;
+    int buffer_start;
+    int buffer_end;
+    int buffer_capacity;
+    //appends are copied into this buffer and written to the end of the file when it fills or
+    //the file is flushed.  'write_buffer_size' is 0 if every append is written straight away
+    char* write_buffer;
+    int write_count;
+    int write_capacity;
+    int write_buffer_size;
 };
 
+//A string is one of:
+//  flat - left == NULL, contents in 'chars'
+//  rope - made by '+', left/right halves and no chars of its own
+//  view - made by slicing, 'length' chars of the flat string 'left' starting at 'offset'
+//Flattening a rope copies the contents and turns it into a view of the whole copy.
+//Use flatten_string() and STRING_CHARS() to read the contents of a string from a Value,
+//or materialize_string() when a flat, null terminated string is needed.
+//
+//Only identifiers, literals, map keys and other short strings are interned.  Transient
+//strings (concatenations, casts, file contents) are not, and hash lazily - use
+//string_hash() and same_string() instead of reading 'hash' or comparing pointers.
 struct ObjString {
     struct Obj base;
-    char* chars;
     int length;
     uint32_t hash;
+    bool is_hashed;
+    bool is_interned;
+    struct ObjString* left;
+    struct ObjString* right;
+    int offset;
+    char chars[]; //length + 1 bytes (null terminated), allocated with the object
+};
+
+//only valid for flat strings and views (eg, the result of flatten_string())
+#define STRING_CHARS(str) ((str)->left == NULL ? (str)->chars : (str)->left->chars + (str)->offset)
+
+//Mutable, uninterned byte buffer.  'chars' is kept null terminated.
+struct ObjStringBuilder {
+    struct Obj base;
+    char* chars;
+    int length;
+    int capacity;
 };
 
+#define STRING_SIZE(length) (sizeof(struct ObjString) + (length) + 1)
+
+//'props' holds the default value of each field and is the template new instances are copied
+//from.  'container_count' is the number of defaults that each instance needs its own copy of
+//(see copied_per_instance).
 struct ObjStruct {
     struct Obj base;
     struct ObjString* name;
     struct Table props;
     struct ObjStruct* super;
+    int container_count;
 };
 
+//'props' lives in the same allocation, right after the instance
 struct ObjInstance {
     struct Obj base;
     struct Table props;
@@ -84,33 +133,137 @@ struct ObjNative {
     ResultCode (*function)(Value*, struct ValueArray*);
 };
 
+//Lists of ints, floats and bytes store their elements unboxed as int32_t, double
+//and uint8_t.  All other lists store Values.
+typedef enum {
+    LIST_BOXED,
+    LIST_INT,
+    LIST_FLOAT,
+    LIST_BYTE
+} ListKind;
+
+//A list either owns its 'count' elements in 'data', or is a view of 'count' elements of
+//the list 'frozen' starting at 'offset' (and 'data' is unused).  Slicing freezes
+//the elements of the sliced list so that both can share them - a view copies its elements
+//out with materialize_list() before it is modified.  Frozen lists are never modified.
 struct ObjList {
     struct Obj base;
-    struct ValueArray values;
+    ListKind kind;
+    void* data;
+    int count;
+    int capacity;
+    struct ObjList* frozen;
+    int offset;
 };
 
+#define LIST_DATA(list, type) \
+    ((type*)((list)->frozen == NULL ? (list)->data : (type*)((list)->frozen->data) + (list)->offset))
+#define LIST_VALUES(list) LIST_DATA(list, Value)
+
+//Keys are ints, bytes, strings (interned) or enums (ints).
+//Like lists, a copied map is a view of the entries of the map 'frozen' (and 'table' is empty)
+//until it is modified - materialize_map() gives it its own copy of the table first.
 struct ObjMap {
     struct Obj base;
-    struct Table table;
+    struct ValueTable table;
+    struct ObjMap* frozen;
+};
+
+#define MAP_TABLE(map) ((map)->frozen == NULL ? &(map)->table : &(map)->frozen->table)
+
+//Set<T> of ints, bytes, strings or enums, stored as the keys of 'table' (values are unused).
+//String elements are interned.
+struct ObjSet {
+    struct Obj base;
+    struct ValueTable table;
+};
+
+//Read-only bytes.  A Bytes either owns 'data' - a whole file mapped into memory, or a
+//buffer when 'mapped' is false - or is a slice of the data owned by 'source'.
+//Bytes are never modified, so slices and copies share the data of their source.
+struct ObjBytes {
+    struct Obj base;
+    const uint8_t* data;
+    int length;
+    bool mapped;
+    struct ObjBytes* source;
+};
+
+#define TENSOR_MAX_RANK 4
+
+//Tensor<float> of 'count' doubles.  Element (i, j, ...) is at i * strides[0] + j * strides[1] + ...
+//A tensor either owns 'data', or is a view (eg, a transpose) of the data of the tensor 'frozen'.
+//Like list views, views copy their elements out with materialize_tensor() before being modified.
+struct ObjTensor {
+    struct Obj base;
+    double* data;
+    int count;
+    int rank;
+    int shape[TENSOR_MAX_RANK];
+    int strides[TENSOR_MAX_RANK];
+    struct ObjTensor* frozen;
 };
 
+#define TENSOR_DATA(tensor) ((tensor)->frozen == NULL ? (tensor)->data : (tensor)->frozen->data)
+
 void insert_object(struct Obj* ptr);
 int free_object(struct Obj* obj);
 void mark_object(struct Obj* obj);
 void print_object(struct Obj* obj);
 
 struct ObjString* make_string(const char* start, int length);
-struct ObjString* take_string(char* start, int length);
-struct ObjInstance* make_instance(struct Table table, struct ObjStruct* klass);
+struct ObjString* allocate_string(int length);
+struct ObjString* intern_string(struct ObjString* str);
+struct ObjString* track_string(struct ObjString* str);
+struct ObjString* make_transient_string(const char* start, int length);
+struct ObjString* intern_in_place(struct ObjString* str);
+uint32_t string_hash(struct ObjString* str);
+bool same_string(struct ObjString* a, struct ObjString* b);
+struct ObjString* concat_strings(struct ObjString* left, struct ObjString* right);
+struct ObjString* flatten_string(struct ObjString* str);
+struct ObjString* materialize_string(struct ObjString* str);
+struct ObjString* make_string_view(struct ObjString* str, int start, int length);
+bool copied_per_instance(Value value);
+struct ObjInstance* make_instance(struct ObjStruct* klass);
 struct ObjStruct* make_struct(struct ObjString* name, struct ObjStruct* super);
 struct ObjFunction* make_function(struct ObjString* name, int arity);
 struct ObjUpvalue* make_upvalue(Value* location);
 struct ObjNative* make_native(struct ObjString* name, ResultCode (*function)(Value*, struct ValueArray*));
-struct ObjList* make_list(void);
+struct ObjList* make_list(ListKind kind);
+struct ObjList* make_list_slice(struct ObjList* list, int start, int end);
+void materialize_list(struct ObjList* list);
+void reserve_list(struct ObjList* list, int capacity);
+Value list_get(struct ObjList* list, int idx);
+void list_set(struct ObjList* list, int idx, Value value);
+void list_append(struct ObjList* list, Value value);
+struct ObjStringBuilder* make_string_builder(void);
+struct ObjStringBuilder* copy_string_builder(struct ObjStringBuilder* sb);
+void append_to_string_builder(struct ObjStringBuilder* sb, const char* chars, int length);
 struct ObjList* copy_list(struct ObjList* l);
+struct ObjMap* copy_map(struct ObjMap* map);
+void materialize_map(struct ObjMap* map);
 struct ObjMap* make_map(void);
+struct ObjSet* make_set(void);
+struct ObjSet* copy_set(struct ObjSet* set);
+struct ObjBytes* map_file(const char* path);
+struct ObjBytes* make_bytes_slice(struct ObjBytes* bytes, int start, int end);
+struct ObjBytes* copy_bytes(struct ObjBytes* bytes);
+struct ObjTensor* make_tensor(int rank, const int* shape);
+struct ObjTensor* make_tensor_view(struct ObjTensor* tensor, int rank, const int* shape, const int* strides);
+bool tensor_is_contiguous(struct ObjTensor* tensor);
+void materialize_tensor(struct ObjTensor* tensor);
+struct ObjTensor* copy_tensor(struct ObjTensor* tensor);
 struct ObjEnum* make_enum(Token name);
-struct ObjFile* make_file(FILE* fp, struct ObjString* file_path);
+struct ObjFile* make_file(FILE* fp, struct ObjString* file_path, const char* mode);
+struct ObjString* read_file_line(struct ObjFile* file);
+bool at_file_end(struct ObjFile* file);
+void reset_file_buffer(struct ObjFile* file);
+bool append_to_file(struct ObjFile* file, const char* chars, int length);
+bool flush_file(struct ObjFile* file);
+bool set_file_write_buffer(struct ObjFile* file, int size);
+long file_position(struct ObjFile* file);
+bool seek_file(struct ObjFile* file, long position);
+struct ObjBytes* read_file_bytes(struct ObjFile* file, int count);
 
 
 #endif// CEBRA_OBJ_H
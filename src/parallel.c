@@ -0,0 +1,486 @@
+#include "common.h"
+
+#ifdef PARALLEL_WORKERS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "parallel.h"
+#include "memory.h"
+#include "obj.h"
+#include "vm.h"
+
+//worker heaps are numbered from 1 since MAIN_HEAP is 0
+#define MAX_WORKERS 64
+
+//0 for one worker per cpu
+static int requested_workers = 0;
+
+typedef enum {
+    JOB_MAP,
+    JOB_REDUCE
+} JobKind;
+
+struct Job;
+
+//A worker leaves its result (the mapped chunk, or the fold of its chunk) at the bottom of
+//its VM stack, where its GC can see it, until the calling thread has copied it out.
+struct Worker {
+    struct Job* job;
+    uint8_t heap;
+    int start;
+    int end;
+    VM* vm;
+    bool failed;
+#ifdef PARALLEL_WORKERS
+    pthread_t thread;
+#else
+    MemoryManager memory;
+#endif
+};
+
+#define WORKER_RESULT(worker) ((worker)->vm->stack[0])
+
+struct Job {
+    JobKind kind;
+    VM* parent;
+    struct ObjList* list;
+    Value fn;
+    Value init;
+    struct Worker workers[MAX_WORKERS];
+    int worker_count;
+#ifdef PARALLEL_WORKERS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int pending; //chunks (and the final fold of a reduce) that aren't done yet
+    bool released; //set once the results are copied out of the worker heaps
+#endif
+};
+
+void set_worker_count(int count) {
+    requested_workers = count;
+}
+
+int worker_count(void) {
+    int count = requested_workers;
+#ifdef PARALLEL_WORKERS
+    if (count <= 0) count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count < 1) count = 1;
+    if (count > MAX_WORKERS) count = MAX_WORKERS;
+    return count;
+}
+
+//Runs on the worker's own heap: maps the elements [start, end) of the list, or folds
+//them from the first one
+static void start_worker(struct Worker* worker) {
+    struct Job* job = worker->job;
+    worker->failed = false;
+    worker->vm = (VM*)malloc(sizeof(VM));
+    if (worker->vm == NULL) {
+        fprintf(stderr, "malloc");
+        exit(1);
+    }
+    VM* vm = worker->vm;
+    init_worker_memory(worker->heap, vm);
+    init_worker_vm(vm, job->parent);
+
+    if (job->kind == JOB_MAP) {
+        struct ObjList* results = make_list(LIST_BOXED);
+        push(vm, to_list(results));
+        reserve_list(results, worker->end - worker->start);
+        for (int i = worker->start; i < worker->end; i++) {
+            push(vm, job->fn);
+            push(vm, list_get(job->list, i));
+            if (call_value(vm, 1) == RESULT_FAILED) {
+                worker->failed = true;
+                return;
+            }
+            list_append(results, vm->stack_top[-1]);
+            pop(vm);
+        }
+        return;
+    }
+
+    push(vm, list_get(job->list, worker->start));
+    for (int i = worker->start + 1; i < worker->end; i++) {
+        push(vm, job->fn);
+        push(vm, vm->stack[0]);
+        push(vm, list_get(job->list, i));
+        if (call_value(vm, 2) == RESULT_FAILED) {
+            worker->failed = true;
+            return;
+        }
+        vm->stack[0] = pop(vm);
+    }
+}
+
+//Runs on the first worker's heap once every chunk is folded: init, then each chunk in order.
+//The other workers' results are read from their heaps.
+static void fold_chunks(struct Job* job) {
+    struct Worker* first = &job->workers[0];
+    for (int i = 0; i < job->worker_count; i++) {
+        if (job->workers[i].failed) return;
+    }
+
+    VM* vm = first->vm;
+    push(vm, job->init);
+    for (int i = 0; i < job->worker_count; i++) {
+        push(vm, job->fn);
+        push(vm, vm->stack[1]);
+        push(vm, WORKER_RESULT(&job->workers[i]));
+        if (call_value(vm, 2) == RESULT_FAILED) {
+            first->failed = true;
+            return;
+        }
+        vm->stack[1] = pop(vm);
+    }
+    vm->stack[0] = pop(vm);
+}
+
+static void stop_worker(struct Worker* worker) {
+    free_worker_vm(worker->vm);
+    free_worker_memory();
+    free(worker->vm);
+    worker->vm = NULL;
+}
+
+#ifdef PARALLEL_WORKERS
+static void* worker_thread(void* arg) {
+    struct Worker* worker = (struct Worker*)arg;
+    struct Job* job = worker->job;
+    start_worker(worker);
+
+    pthread_mutex_lock(&job->lock);
+    job->pending--;
+    pthread_cond_broadcast(&job->cond);
+    if (job->kind == JOB_REDUCE && worker == &job->workers[0]) {
+        while (job->pending > 1) {
+            pthread_cond_wait(&job->cond, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+        fold_chunks(job);
+        pthread_mutex_lock(&job->lock);
+        job->pending--;
+        pthread_cond_broadcast(&job->cond);
+    }
+
+    //the calling thread reads this worker's heap until it releases the workers
+    while (!job->released) {
+        pthread_cond_wait(&job->cond, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    stop_worker(worker);
+    return NULL;
+}
+
+static void start_workers(struct Job* job) {
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->cond, NULL);
+    job->pending = job->worker_count + (job->kind == JOB_REDUCE ? 1 : 0);
+    job->released = false;
+    for (int i = 0; i < job->worker_count; i++) {
+        if (pthread_create(&job->workers[i].thread, NULL, worker_thread, &job->workers[i]) != 0) {
+            fprintf(stderr, "[Error] Failed to start worker thread\n");
+            exit(1);
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (job->pending > 0) {
+        pthread_cond_wait(&job->cond, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void stop_workers(struct Job* job) {
+    pthread_mutex_lock(&job->lock);
+    job->released = true;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+    for (int i = 0; i < job->worker_count; i++) {
+        pthread_join(job->workers[i].thread, NULL);
+    }
+    pthread_cond_destroy(&job->cond);
+    pthread_mutex_destroy(&job->lock);
+}
+#else
+//without threads the workers take turns on the calling thread, swapping heaps
+static void start_workers(struct Job* job) {
+    MemoryManager caller = mm;
+    for (int i = 0; i < job->worker_count; i++) {
+        start_worker(&job->workers[i]);
+        job->workers[i].memory = mm;
+    }
+    if (job->kind == JOB_REDUCE) {
+        mm = job->workers[0].memory;
+        fold_chunks(job);
+        job->workers[0].memory = mm;
+    }
+    mm = caller;
+}
+
+static void stop_workers(struct Job* job) {
+    MemoryManager caller = mm;
+    for (int i = 0; i < job->worker_count; i++) {
+        mm = job->workers[i].memory;
+        stop_worker(&job->workers[i]);
+    }
+    mm = caller;
+}
+#endif
+
+static bool import_value(Value value, Value* copy);
+
+static bool import_table(struct Table* dst, struct Table* src) {
+    for (int i = 0; i < src->entry_count; i++) {
+        struct Entry* entry = &src->entries[i];
+        if (entry->key == NULL) continue;
+
+        Value key;
+        if (!import_value(to_string(entry->key), &key)) return false;
+        push_root(key);
+        struct ObjString* interned = intern_in_place(key.as.string_type);
+        push_root(to_string(interned));
+        Value value;
+        bool imported = import_value(entry->value, &value);
+        if (imported) {
+            push_root(value);
+            set_entry(dst, interned, value);
+            pop_root();
+        }
+        pop_root();
+        pop_root();
+        if (!imported) return false;
+    }
+    return true;
+}
+
+static bool import_value_table(struct ValueTable* dst, struct ValueTable* src) {
+    for (int i = 0; i < src->entry_count; i++) {
+        struct ValueEntry* entry = &src->entries[i];
+        if (entry->key.type == VAL_NIL) continue;
+
+        Value key;
+        if (!import_value(entry->key, &key)) return false;
+        if (key.type == VAL_STRING) {
+            push_root(key);
+            key = to_string(intern_in_place(key.as.string_type));
+            pop_root();
+        }
+        push_root(key);
+        Value value;
+        bool imported = import_value(entry->value, &value);
+        if (imported) {
+            push_root(value);
+            set_value_entry(dst, key, value);
+            pop_root();
+        }
+        pop_root();
+        if (!imported) return false;
+    }
+    return true;
+}
+
+//Copies a value made by a worker onto the calling thread's heap.  Primitives and objects
+//already on the calling heap are returned as is.  Fails on functions, structs, enums and
+//files made by the worker.  'copy' must be made reachable by the caller.
+static bool import_value(Value value, Value* copy) {
+    struct Obj* obj = get_object(&value);
+    if (obj == NULL || !IS_FOREIGN(obj)) {
+        *copy = value;
+        return true;
+    }
+
+    switch (obj->type) {
+        case OBJ_STRING: {
+            struct ObjString* str = flatten_string((struct ObjString*)obj);
+            if (IS_FOREIGN(str)) str = make_string(STRING_CHARS(str), str->length);
+            *copy = to_string(str);
+            return true;
+        }
+        case OBJ_LIST: {
+            struct ObjList* src = (struct ObjList*)obj;
+            if (src->kind != LIST_BOXED) {
+                *copy = to_list(copy_list(src));
+                return true;
+            }
+
+            struct ObjList* list = make_list(LIST_BOXED);
+            push_root(to_list(list));
+            reserve_list(list, src->count);
+            for (int i = 0; i < src->count; i++) {
+                Value element;
+                if (!import_value(list_get(src, i), &element)) {
+                    pop_root();
+                    return false;
+                }
+                push_root(element);
+                list_append(list, element);
+                pop_root();
+            }
+            pop_root();
+            *copy = to_list(list);
+            return true;
+        }
+        case OBJ_MAP: {
+            struct ObjMap* map = make_map();
+            push_root(to_map(map));
+            bool imported = import_value_table(&map->table, MAP_TABLE((struct ObjMap*)obj));
+            pop_root();
+            *copy = to_map(map);
+            return imported;
+        }
+        case OBJ_INSTANCE: {
+            struct ObjInstance* src = (struct ObjInstance*)obj;
+            if (IS_FOREIGN(src->klass)) return false;
+            struct ObjInstance* inst = make_instance(src->klass);
+            push_root(to_instance(inst));
+            bool imported = import_table(&inst->props, &src->props);
+            pop_root();
+            *copy = to_instance(inst);
+            return imported;
+        }
+        case OBJ_TENSOR: {
+            *copy = to_tensor(copy_tensor((struct ObjTensor*)obj));
+            return true;
+        }
+        case OBJ_SET: {
+            *copy = to_set(copy_set((struct ObjSet*)obj));
+            return true;
+        }
+        case OBJ_BYTES: {
+            //a slice of Bytes on this heap can share them, anything else is copied
+            struct ObjBytes* src = (struct ObjBytes*)obj;
+            if (src->source != NULL && !IS_FOREIGN(src->source)) {
+                *copy = to_bytes(make_bytes_slice(src, 0, src->length));
+            } else {
+                *copy = to_bytes(copy_bytes(src));
+            }
+            return true;
+        }
+        case OBJ_STRING_BUILDER: {
+            struct ObjStringBuilder* src = (struct ObjStringBuilder*)obj;
+            struct ObjStringBuilder* sb = make_string_builder();
+            push_root(to_string_builder(sb));
+            append_to_string_builder(sb, src->chars, src->length);
+            pop_root();
+            *copy = to_string_builder(sb);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static ListKind list_kind_of(Value value) {
+    switch (value.type) {
+        case VAL_INT: return LIST_INT;
+        case VAL_FLOAT: return LIST_FLOAT;
+        case VAL_BYTE: return LIST_BYTE;
+        default: return LIST_BOXED;
+    }
+}
+
+static bool import_results(struct Job* job, Value* result) {
+    if (job->kind == JOB_REDUCE) return import_value(WORKER_RESULT(&job->workers[0]), result);
+
+    //the compiler knows the element type, but the first result is enough to pick the
+    //same packed kind - any later value that doesn't fit boxes the list like it would anyway
+    struct ObjList* first = WORKER_RESULT(&job->workers[0]).as.list_type;
+    struct ObjList* list = make_list(list_kind_of(list_get(first, 0)));
+    push_root(to_list(list));
+    reserve_list(list, job->list->count);
+    for (int i = 0; i < job->worker_count; i++) {
+        struct ObjList* results = WORKER_RESULT(&job->workers[i]).as.list_type;
+        for (int j = 0; j < results->count; j++) {
+            Value element;
+            if (!import_value(list_get(results, j), &element)) {
+                pop_root();
+                return false;
+            }
+            push_root(element);
+            list_append(list, element);
+            pop_root();
+        }
+    }
+    pop_root();
+    *result = to_list(list);
+    return true;
+}
+
+static ResultCode run_job(struct Job* job, Value* result) {
+    //workers can't start workers of their own
+    if (mm.heap != MAIN_HEAP) return RESULT_FAILED;
+
+    int count = job->list->count;
+    job->parent = mm.vm;
+    job->worker_count = worker_count();
+    if (job->worker_count > count) job->worker_count = count;
+
+    //contiguous chunks, with the first 'count % worker_count' chunks one element longer
+    int start = 0;
+    for (int i = 0; i < job->worker_count; i++) {
+        struct Worker* worker = &job->workers[i];
+        int size = count / job->worker_count + (i < count % job->worker_count ? 1 : 0);
+        worker->job = job;
+        worker->heap = (uint8_t)(i + 1);
+        worker->start = start;
+        worker->end = start + size;
+        worker->vm = NULL;
+        start += size;
+    }
+
+    start_workers(job);
+
+    bool failed = false;
+    for (int i = 0; i < job->worker_count; i++) {
+        struct Worker* worker = &job->workers[i];
+        if (!worker->failed) continue;
+        failed = true;
+        for (int j = 0; j < worker->vm->error_count; j++) {
+            printf("Runtime Error: ");
+            printf("%s\n", worker->vm->errors[j].message);
+        }
+    }
+
+    if (!failed && !import_results(job, result)) {
+        printf("Runtime Error: ");
+        printf("Parallel workers can only return primitives, strings, List, Map, struct instances and tensors.\n");
+        failed = true;
+    }
+
+    stop_workers(job);
+    return failed ? RESULT_FAILED : RESULT_SUCCESS;
+}
+
+ResultCode parallel_map(struct ObjList* list, Value fn, Value* result) {
+    if (list->count == 0) {
+        *result = to_list(make_list(LIST_BOXED));
+        return RESULT_SUCCESS;
+    }
+
+    struct Job job;
+    job.kind = JOB_MAP;
+    job.list = list;
+    job.fn = fn;
+    job.init = to_nil();
+    return run_job(&job, result);
+}
+
+//'fn' must be associative - each worker folds its own chunk, and the chunk results
+//are then folded in order starting from 'init'
+ResultCode parallel_reduce(struct ObjList* list, Value fn, Value init, Value* result) {
+    if (list->count == 0) {
+        *result = init;
+        return RESULT_SUCCESS;
+    }
+
+    struct Job job;
+    job.kind = JOB_REDUCE;
+    job.list = list;
+    job.fn = fn;
+    job.init = init;
+    return run_job(&job, result);
+}
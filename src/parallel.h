@@ -0,0 +1,17 @@
+#ifndef CEBRA_PARALLEL_H
+#define CEBRA_PARALLEL_H
+
+#include "value.h"
+#include "result_code.h"
+
+//parallel_map and parallel_reduce split a list into one contiguous chunk per worker.  Each
+//worker runs the function on its own thread with its own VM and heap, reading the list,
+//the function and anything it captures straight from the calling heap (which is not
+//modified while the workers run).  Results are copied back to the calling heap in list order.
+
+void set_worker_count(int count);
+int worker_count(void);
+ResultCode parallel_map(struct ObjList* list, Value fn, Value* result);
+ResultCode parallel_reduce(struct ObjList* list, Value fn, Value init, Value* result);
+
+#endif// CEBRA_PARALLEL_H
@@ -228,12 +228,27 @@ static ResultCode primary(struct Node** node) {
     } else if (match(TOKEN_MAP)) {
         Token identifier = parser.previous;
         CONSUME(TOKEN_LESS, identifier, "Expect '<' after 'Map'.");
+        struct Type* key_type = make_string_type();
         struct Type* template_type;
-        PARSE(parse_type, &template_type, identifier, "Map must be initialized with valid type: Map<[type]>().");
+        PARSE(parse_type, &template_type, identifier, "Map must be initialized with valid type: Map<[type]>() or Map<[key type], [type]>().");
+        if (match(TOKEN_COMMA)) {
+            key_type = template_type;
+            PARSE(parse_type, &template_type, identifier, "Map must be initialized with valid type: Map<[type]>() or Map<[key type], [type]>().");
+        }
+        CONSUME(TOKEN_GREATER, identifier, "Expect '>' after type.");
+        CONSUME(TOKEN_LEFT_PAREN, identifier, "Create container using '()'.");
+        CONSUME(TOKEN_RIGHT_PAREN, identifier, "Create container using '()'.");
+        *node = make_decl_container(identifier, make_map_type(key_type, template_type)); 
+        return RESULT_SUCCESS;
+    } else if (match(TOKEN_SET)) {
+        Token identifier = parser.previous;
+        CONSUME(TOKEN_LESS, identifier, "Expect '<' after 'Set'.");
+        struct Type* template_type;
+        PARSE(parse_type, &template_type, identifier, "Set must be initialized with valid type: Set<[type]>().");
         CONSUME(TOKEN_GREATER, identifier, "Expect '>' after type.");
         CONSUME(TOKEN_LEFT_PAREN, identifier, "Create container using '()'.");
         CONSUME(TOKEN_RIGHT_PAREN, identifier, "Create container using '()'.");
-        *node = make_decl_container(identifier, make_map_type(template_type)); 
+        *node = make_decl_container(identifier, make_set_type(template_type)); 
         return RESULT_SUCCESS;
     } else if (match(TOKEN_IDENTIFIER)) {
         //checking for TOKEN_IDENTIFIER + TOKEN_COLON before getting to this function
@@ -574,6 +589,24 @@ static ResultCode parse_type(struct Type** type) {
         return RESULT_SUCCESS;
     }
 
+    if (match(TOKEN_STRING_BUILDER_TYPE)) {
+        *type = make_string_builder_type();
+        return RESULT_SUCCESS;
+    }
+
+    if (match(TOKEN_TENSOR_TYPE)) {
+        CONSUME(TOKEN_LESS, parser.previous, "Expect '<' after 'Tensor'.");
+        CONSUME(TOKEN_FLOAT_TYPE, parser.previous, "Tensor element type must be 'float'.");
+        CONSUME(TOKEN_GREATER, parser.previous, "Expect '>' after type.");
+        *type = make_tensor_type();
+        return RESULT_SUCCESS;
+    }
+
+    if (match(TOKEN_BYTES_TYPE)) {
+        *type = make_bytes_type();
+        return RESULT_SUCCESS;
+    }
+
     if (match(TOKEN_BYTE_TYPE)) {
         *type = make_byte_type();
         return RESULT_SUCCESS;
@@ -610,10 +643,24 @@ static ResultCode parse_type(struct Type** type) {
 
     if (match(TOKEN_MAP)) {
         CONSUME(TOKEN_LESS, parser.previous, "Expect '<' after 'Map'.");
+        struct Type* key_type = make_string_type();
         struct Type* template_type;
         PARSE(parse_type, &template_type, parser.previous, "Map declaration type invalid. Specify value type inside '<>'.");
+        if (match(TOKEN_COMMA)) {
+            key_type = template_type;
+            PARSE(parse_type, &template_type, parser.previous, "Map declaration type invalid. Specify key and value types inside '<>'.");
+        }
+        CONSUME(TOKEN_GREATER, parser.previous, "Expect '>' after type.");
+        *type = make_map_type(key_type, template_type);
+        return RESULT_SUCCESS;
+    }
+
+    if (match(TOKEN_SET)) {
+        CONSUME(TOKEN_LESS, parser.previous, "Expect '<' after 'Set'.");
+        struct Type* template_type;
+        PARSE(parse_type, &template_type, parser.previous, "Set declaration type invalid. Specify element type inside '<>'.");
         CONSUME(TOKEN_GREATER, parser.previous, "Expect '>' after type.");
-        *type = make_map_type(template_type);
+        *type = make_set_type(template_type);
         return RESULT_SUCCESS;
     }
 
@@ -889,40 +936,13 @@ static ResultCode declaration(struct Node** node) {
 
         CONSUME(TOKEN_IN, name, "Expect 'in' after element declaration.");
 
-        struct Node* list;
-        PARSE(parse_expression, &list, name, "Expect List identifier after 'in' in foreach loop.");
-
-        //initializer
-        Token idx_token = make_token(TOKEN_IDENTIFIER, -1, "_idx_", 5);
-        Token zero_token = make_token(TOKEN_INT, -1, "0", 1);
-        struct Node* initializer = make_decl_var(idx_token, make_int_type(), make_literal(zero_token));
-
-        //condition 
-        Token prop_token = make_token(TOKEN_IDENTIFIER, -1, "size", 4);
-        Token less_token = make_token(TOKEN_LESS, -1, "<", 1);
-        struct Node* get_idx = make_get_var(idx_token);
-        struct Node* get_size = make_get_prop(list, prop_token);
-        struct Node* condition = make_logical(less_token, get_idx, get_size);
-
-        //update
-        Token plus_token = make_token(TOKEN_PLUS, -1, "+", 1);
-        Token one_token = make_token(TOKEN_INT, -1, "1", 1);
-        struct Node* sum = make_binary(plus_token, get_idx, make_literal(one_token));
-        struct Node* update = make_expr_stmt(make_set_var(get_idx, sum)); 
-
-        //body
-        struct Node* get_element = make_get_element(make_dummy_token(), list, get_idx);
-        ((DeclVar*)element)->right = get_element;
-
-        //prepending element to body
-        struct NodeList* body = (struct NodeList*)make_node_list();
-        add_node(body, element);
-        struct Node* remaining_body;
-        PARSE(declaration, &remaining_body, name, "Expected body statement for 'foreach' loop.");
-        add_node(body, remaining_body);
-        struct Node* then_block = make_block(name, body);
+        struct Node* iterable;
+        PARSE(parse_expression, &iterable, name, "Expect List identifier after 'in' in foreach loop.");
 
-        *node = make_for(name, initializer, condition, update, then_block);
+        struct Node* then_block;
+        PARSE(declaration, &then_block, name, "Expected body statement for 'foreach' loop.");
+
+        *node = make_for_each(name, element, iterable, then_block);
         return RESULT_SUCCESS;
     } else if (match(TOKEN_RIGHT_ARROW)) {
         Token name = parser.previous;
@@ -974,7 +994,7 @@ int compare(const void* a, const void* b) {
 }
 
 static ResultCode check_global_circular_inheritance(struct Table* globals) {
-    for (int i = 0; i < globals->capacity; i++) {
+    for (int i = 0; i < globals->entry_count; i++) {
         struct Entry* entry = &globals->entries[i];
         if (entry->value.type != VAL_TYPE) continue;
         if (entry->value.as.type_type->type != TYPE_STRUCT) continue;
@@ -1000,7 +1020,7 @@ static ResultCode check_global_circular_inheritance(struct Table* globals) {
 
 static ResultCode copy_global_inherited_props(struct Table* globals) {
 
-    for (int i = 0; i < globals->capacity; i++) {
+    for (int i = 0; i < globals->entry_count; i++) {
         struct Entry* entry = &globals->entries[i];
         if (entry->value.type != VAL_TYPE) continue;
         if (entry->value.as.type_type->type != TYPE_STRUCT) continue;
@@ -1009,7 +1029,7 @@ static ResultCode copy_global_inherited_props(struct Table* globals) {
         struct Type* super_type = klass->super;
         while (super_type != NULL) {
             struct TypeStruct* super = (struct TypeStruct*)super_type;
-            for (int j = 0; j < super->props.capacity; j++) {
+            for (int j = 0; j < super->props.entry_count; j++) {
                 struct Entry* entry = &super->props.entries[j];
                 if (entry->key == NULL) continue;
                 Value val;
@@ -1057,7 +1077,7 @@ static ResultCode add_struct_by_order(struct NodeList* nl, struct Table* struct_
 
 
 static ResultCode resolve_global_function_identifiers(struct Table* globals) {
-    for (int i = 0; i < globals->capacity; i++) {
+    for (int i = 0; i < globals->entry_count; i++) {
         struct Entry* entry = &globals->entries[i];
         if (entry->value.type != VAL_TYPE) continue;
         if (entry->value.as.type_type->type != TYPE_FUN) continue;
@@ -1068,7 +1088,7 @@ static ResultCode resolve_global_function_identifiers(struct Table* globals) {
 }
 
 static ResultCode resolve_global_struct_identifiers(struct Table* globals) {
-    for (int i = 0; i < globals->capacity; i++) {
+    for (int i = 0; i < globals->entry_count; i++) {
         struct Entry* entry = &globals->entries[i];
         if (entry->value.type != VAL_TYPE || entry->value.as.type_type->type != TYPE_STRUCT) continue;
 
@@ -1155,7 +1175,7 @@ static ResultCode resolve_type_identifiers(struct Type** type, struct Table* glo
         case TYPE_STRUCT: {
             struct TypeStruct* ts = (struct TypeStruct*)(*type);
             //resolve properties
-            for (int j = 0; j < ts->props.capacity; j++) {
+            for (int j = 0; j < ts->props.entry_count; j++) {
                 struct Entry* inner_entry = &ts->props.entries[j];
                 if (inner_entry->value.type != VAL_TYPE) continue;
 
@@ -1195,10 +1215,18 @@ static ResultCode resolve_type_identifiers(struct Type** type, struct Table* glo
         }
         case TYPE_MAP: {
            struct TypeMap* tm = (struct TypeMap*)(*type);
+           if (resolve_type_identifiers(&tm->key_type, globals) == RESULT_FAILED)
+               result = RESULT_FAILED;
            if (resolve_type_identifiers(&tm->type, globals) == RESULT_FAILED)
                result = RESULT_FAILED;
            break;
         }
+        case TYPE_SET: {
+           struct TypeSet* ts = (struct TypeSet*)(*type);
+           if (resolve_type_identifiers(&ts->type, globals) == RESULT_FAILED)
+               result = RESULT_FAILED;
+           break;
+        }
         default:
            break;
     }
@@ -3,33 +3,221 @@
 
 #include "table.h"
 #include "memory.h"
+#include "obj.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define TABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define GROUP_SIZE 16
+
+//full slots hold the low 7 bits of the hash, so only empty and deleted slots have the top bit set
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+
+#define HASH_GROUP(hash) ((hash) >> 7)
+#define HASH_CTRL(hash) ((uint8_t)((hash) & 0x7F))
+
+//Tables hold at most 7/8 as many entries (counting removed ones) as slots, so at most 7/8 of the
+//slots are full or deleted and every probe ends at an empty slot
+#define MAX_LOAD_NUMERATOR 7
+#define MAX_LOAD_DENOMINATOR 8
+
+//an insert packs a table once more than 1/8 of its slots are tombstones, so that tables with
+//many removals keep short probes without waiting for the entries to fill up
+#define MAX_TOMBSTONES(capacity) ((capacity) / 8)
+
+//bit i is set if ctrl[i] == byte, for the GROUP_SIZE control bytes starting at 'ctrl'
+static uint32_t match_ctrl(const uint8_t* ctrl, uint8_t byte) {
+#ifdef TABLE_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        if (ctrl[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+//bit i is set if ctrl[i] is empty or deleted
+static uint32_t match_free(const uint8_t* ctrl) {
+#ifdef TABLE_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint32_t)_mm_movemask_epi8(group);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        if (ctrl[i] & 0x80) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static int lowest_bit(uint32_t mask) {
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
 
-#define MAX_LOAD 0.75
+//Groups are probed in triangular steps (+1, +2, +3...), which visits every group
+//when the number of groups is a power of two.
+#define NEXT_GROUP(group, step, group_mask) (((group) + (step)) & (group_mask))
 
-static void reset_table_capacity(struct Table* table, int capacity) {
-    table->entries = GROW_ARRAY(table->entries, struct Entry, capacity, table->capacity);
+static int max_entries(int capacity) {
+    return capacity / MAX_LOAD_DENOMINATOR * MAX_LOAD_NUMERATOR;
+}
+
+//entries, then indices, then control bytes
+static size_t slots_size(size_t entry_size, int entry_capacity, int capacity) {
+    return entry_size * (size_t)entry_capacity + (sizeof(int32_t) + sizeof(uint8_t)) * (size_t)capacity;
+}
+
+static void set_slots(struct Table* table, void* slots, int entry_capacity, int capacity) {
+    table->entries = (struct Entry*)slots;
+    table->indices = (int32_t*)(table->entries + entry_capacity);
+    table->ctrl = (uint8_t*)(table->indices + capacity);
+    table->entry_capacity = entry_capacity;
     table->capacity = capacity;
-    table->count = 0;
-    for (int i = 0; i < table->capacity; i++) {
-        table->entries[i].key = NULL;
-        table->entries[i].value = to_nil();
+}
+
+//index of the slot holding 'key', or -1 if it isn't in the table
+static int find_slot(struct Table* table, struct ObjString* key, uint32_t hash) {
+    if (table->capacity == 0) return -1;
+
+    int group_mask = table->capacity / GROUP_SIZE - 1;
+    int group = HASH_GROUP(hash) & group_mask;
+    for (int step = 1; ; step++) {
+        const uint8_t* ctrl = table->ctrl + group * GROUP_SIZE;
+        uint32_t matches = match_ctrl(ctrl, HASH_CTRL(hash));
+        while (matches != 0) {
+            int slot = group * GROUP_SIZE + lowest_bit(matches);
+            if (same_string(table->entries[table->indices[slot]].key, key)) return slot;
+            matches &= matches - 1;
+        }
+        if (match_ctrl(ctrl, CTRL_EMPTY) != 0) return -1;
+        group = NEXT_GROUP(group, step, group_mask);
+    }
+}
+
+//first empty or deleted slot on the probe sequence of 'hash'
+static int find_free_slot(uint8_t* ctrl, int capacity, uint32_t hash) {
+    int group_mask = capacity / GROUP_SIZE - 1;
+    int group = HASH_GROUP(hash) & group_mask;
+    for (int step = 1; ; step++) {
+        uint32_t free_slots = match_free(ctrl + group * GROUP_SIZE);
+        if (free_slots != 0) return group * GROUP_SIZE + lowest_bit(free_slots);
+        group = NEXT_GROUP(group, step, group_mask);
     }
 }
 
+//Packs the entries of 'src' into the front of 'dest' (in order, dropping removed ones) and
+//rebuilds the index of 'dest' for them.  'dest' and 'src' may be the same table.
+static void pack_entries(struct Table* dest, struct Table* src) {
+    memset(dest->ctrl, CTRL_EMPTY, dest->capacity);
+    int count = 0;
+    for (int i = 0; i < src->entry_count; i++) {
+        struct Entry* entry = &src->entries[i];
+        if (entry->key == NULL) continue;
+        uint32_t hash = string_hash(entry->key);
+        int slot = find_free_slot(dest->ctrl, dest->capacity, hash);
+        dest->ctrl[slot] = HASH_CTRL(hash);
+        dest->indices[slot] = count;
+        dest->entries[count++] = *entry;
+    }
+    dest->count = count;
+    dest->entry_count = count;
+    dest->tombstones = 0;
+}
+
+//Makes room for at least 'min_count' entries.  A table that is mostly removed entries is packed
+//in place, otherwise the entries move to a larger allocation.  Keys and values are moved, not
+//copied, and the order of the entries is kept.
+static void rehash_table(struct Table* table, int min_count) {
+    if (table->capacity != 0 && min_count * 2 <= table->capacity) {
+        pack_entries(table, table);
+        return;
+    }
+
+    //at most half full afterwards
+    int capacity = table->capacity == 0 ? GROUP_SIZE : table->capacity;
+    while (min_count * 2 > capacity) capacity *= 2;
+
+    //allocating can trigger a collection, so the old table is left untouched (and traceable)
+    //until the new slots are ready
+    struct Table new_table;
+    int entry_capacity = max_entries(capacity);
+    set_slots(&new_table, GROW_ARRAY(NULL, uint8_t, slots_size(sizeof(struct Entry), entry_capacity, capacity), 0), entry_capacity, capacity);
+    pack_entries(&new_table, table);
+
+    FREE_ARRAY(table->entries, uint8_t, slots_size(sizeof(struct Entry), table->entry_capacity, table->capacity));
+    *table = new_table;
+}
+
 void init_table(struct Table* table) {
+    table->entries = NULL;
+    table->indices = NULL;
+    table->ctrl = NULL;
     table->count = 0;
+    table->entry_count = 0;
+    table->entry_capacity = 0;
     table->capacity = 0;
-    table->entries = ALLOCATE_ARRAY(struct Entry);
+    table->tombstones = 0;
 }
 
 int free_table(struct Table* table) {
-    return FREE_ARRAY(table->entries, struct Entry, table->capacity);
+    return FREE_ARRAY(table->entries, uint8_t, slots_size(sizeof(struct Entry), table->entry_capacity, table->capacity));
+}
+
+//size of the block copy_table_into() needs for a copy of 'table'
+size_t table_bytes(struct Table* table) {
+    return slots_size(sizeof(struct Entry), table->entry_count, table->capacity);
 }
 
+static void copy_slots(struct Table* dest, struct Table* src) {
+    if (src->capacity == 0) return;
+    memcpy(dest->entries, src->entries, sizeof(struct Entry) * src->entry_count);
+    memcpy(dest->indices, src->indices, sizeof(int32_t) * src->capacity);
+    memcpy(dest->ctrl, src->ctrl, src->capacity);
+    dest->count = src->count;
+    dest->entry_count = src->entry_count;
+    dest->tombstones = src->tombstones;
+}
+
+//'dest' becomes a copy of 'src' stored in 'slots' - table_bytes(src) bytes owned by the caller.
+//Values are copied as is.  'dest' has no room for more entries, so only keys already in it
+//can be set.
+void copy_table_into(struct Table* dest, struct Table* src, void* slots) {
+    init_table(dest);
+    set_slots(dest, slots, src->entry_count, src->capacity);
+    copy_slots(dest, src);
+}
+
+//'dest' must be empty, and becomes a copy of 'src' (values as is) in a single allocation
+void clone_table(struct Table* dest, struct Table* src) {
+    if (src->capacity == 0) return;
+    int entry_capacity = max_entries(src->capacity);
+    set_slots(dest, GROW_ARRAY(NULL, uint8_t, slots_size(sizeof(struct Entry), entry_capacity, src->capacity), 0), entry_capacity, src->capacity);
+    copy_slots(dest, src);
+}
+
+//'dest' is replaced with copies of the entries in 'src' (see copy_value)
 void copy_table(struct Table* dest, struct Table* src) {
-    reset_table_capacity(dest, src->capacity); 
+    free_table(dest);
+    init_table(dest);
+    if (src->count > 0) rehash_table(dest, src->count);
+
     int pushed = 0;
-    for (int i = 0; i < src->capacity; i++) {
+    for (int i = 0; i < src->entry_count; i++) {
         struct Entry* pair = &src->entries[i];
         if (pair->key == NULL) continue;
 
@@ -44,157 +232,295 @@ void copy_table(struct Table* dest, struct Table* src) {
     }
 }
 
-static void grow_table(struct Table* table) {
-    struct Table temp;
-    init_table(&temp);
-    copy_table(&temp, table);
-    int pushed_count = 0;
-    for (int i = 0; i < temp.capacity; i++) {
-        struct Entry* pair = &temp.entries[i];
-        if (pair->key == NULL) continue;
-        push_root(to_string(pair->key));
-        push_root(pair->value);
-        pushed_count += 2;
+void set_entry(struct Table* table, struct ObjString* key, Value value) {
+    uint32_t hash = string_hash(key);
+    int slot = find_slot(table, key, hash);
+    if (slot != -1) {
+        table->entries[table->indices[slot]].value = value;
+        return;
     }
 
-
-    int new_capacity = table->capacity == 0 ? 8 : table->capacity * 2;
-    reset_table_capacity(table, new_capacity);
-
-    for (int i = 0; i < temp.capacity; i++) {
-        struct Entry* pair = &temp.entries[i];
-        if (pair->key == NULL) continue;
-        set_entry(table, pair->key, pair->value);
+    if (table->entry_count == table->entry_capacity || table->tombstones > MAX_TOMBSTONES(table->capacity)) {
+        rehash_table(table, table->count + 1);
     }
 
-    free_table(&temp);
+    slot = find_free_slot(table->ctrl, table->capacity, hash);
+    if (table->ctrl[slot] == CTRL_DELETED) table->tombstones--;
+    table->ctrl[slot] = HASH_CTRL(hash);
+    table->indices[slot] = table->entry_count;
+    table->entries[table->entry_count].key = key;
+    table->entries[table->entry_count].value = value;
+    table->entry_count++;
+    table->count++;
+}
 
-    for (int i = 0; i < pushed_count; i++) {
-        pop_root();
+bool get_entry(struct Table* table, struct ObjString* key, Value* value) {
+    int slot = find_slot(table, key, string_hash(key));
+    if (slot == -1) return false;
+    *value = table->entries[table->indices[slot]].value;
+    return true;
+}
+
+struct ObjString* find_interned_string(struct Table* table, const char* chars, int length, uint32_t hash) {
+    if (table->capacity == 0) return NULL;
+
+    int group_mask = table->capacity / GROUP_SIZE - 1;
+    int group = HASH_GROUP(hash) & group_mask;
+    for (int step = 1; ; step++) {
+        const uint8_t* ctrl = table->ctrl + group * GROUP_SIZE;
+        uint32_t matches = match_ctrl(ctrl, HASH_CTRL(hash));
+        while (matches != 0) {
+            int slot = group * GROUP_SIZE + lowest_bit(matches);
+            struct ObjString* key = table->entries[table->indices[slot]].key;
+            if (string_hash(key) == hash && key->length == length && memcmp(key->chars, chars, length) == 0) {
+                return key;
+            }
+            matches &= matches - 1;
+        }
+        if (match_ctrl(ctrl, CTRL_EMPTY) != 0) return NULL;
+        group = NEXT_GROUP(group, step, group_mask);
     }
 }
 
+//The entry is left in place with a NULL key, so entries can be removed while walking the table
+//(only inserts pack the table).
+void delete_entry(struct Table* table, struct ObjString* key) {
+    int slot = find_slot(table, key, string_hash(key));
+    if (slot == -1) return;
+
+    //Lookups stop at the first group with an empty slot, so if this group still has one no
+    //probe sequence continues past it and the slot can simply be emptied.  Otherwise it
+    //becomes a tombstone until the table is packed.
+    const uint8_t* group = table->ctrl + (slot / GROUP_SIZE) * GROUP_SIZE;
+    if (match_ctrl(group, CTRL_EMPTY) != 0) {
+        table->ctrl[slot] = CTRL_EMPTY;
+    } else {
+        table->ctrl[slot] = CTRL_DELETED;
+        table->tombstones++;
+    }
 
-void set_entry(struct Table* table, struct ObjString* key, Value value) {
-    Value v;
-    if (!get_entry(table, key, &v) && table->capacity * MAX_LOAD < table->count + 1) {
-        grow_table(table);
+    struct Entry* entry = &table->entries[table->indices[slot]];
+    entry->key = NULL;
+    entry->value = to_nil();
+    table->count--;
+}
+
+void print_table(struct Table* table) {
+    printf("Table count: %d, Table capacity: %d \n", table->count, table->capacity);
+    for (int i = 0; i < table->entry_count; i++) {
+        struct Entry* pair = &table->entries[i];
+        printf("[%d] ", i);
+        if (pair->key != NULL) {
+            printf("Key: %.*s, Value: ", pair->key->length, pair->key->chars);
+            print_value(pair->value);
+            printf("\n");
+        } else {
+            printf("removed\n");
+        }
     }
+}
 
-    int first_tombstone = -1;
+//Multiplicative (Fibonacci) hashing.  The top half of the product depends on every bit of 'bits',
+//so consecutive ids spread over all the groups.
+static uint32_t hash_bits(uint32_t bits) {
+    return (uint32_t)(((uint64_t)bits * 0x9E3779B97F4A7C15ull) >> 32);
+}
 
-    int idx = key->hash % table->capacity;
-    for (;;) {
-        struct Entry* pair = &table->entries[idx];
+uint32_t value_hash(Value key) {
+    switch (key.type) {
+        case VAL_STRING: return string_hash(key.as.string_type);
+        case VAL_INT: return hash_bits((uint32_t)key.as.integer_type);
+        case VAL_BYTE: return hash_bits(key.as.byte_type);
+        case VAL_BOOL: return hash_bits(key.as.boolean_type);
+        default: return 0;
+    }
+}
 
-        if (pair->key == NULL && pair->value.type == VAL_NIL) {
-            if (first_tombstone != -1) {
-                table->entries[first_tombstone].key = key;
-                table->entries[first_tombstone].value = value;
-            } else {
-                table->entries[idx].key = key;
-                table->entries[idx].value = value;
-            }
-            table->count++;
-            return;
-        }
+static bool same_key(Value a, Value b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+        case VAL_STRING: return same_string(a.as.string_type, b.as.string_type);
+        case VAL_INT: return a.as.integer_type == b.as.integer_type;
+        case VAL_BYTE: return a.as.byte_type == b.as.byte_type;
+        case VAL_BOOL: return a.as.boolean_type == b.as.boolean_type;
+        default: return false;
+    }
+}
 
-        if (pair->key == NULL && pair->value.type == VAL_BOOL && pair->value.as.boolean_type && first_tombstone == -1) {
-            first_tombstone = idx;
-        }
+static void set_value_slots(struct ValueTable* table, void* slots, int entry_capacity, int capacity) {
+    table->entries = (struct ValueEntry*)slots;
+    table->indices = (int32_t*)(table->entries + entry_capacity);
+    table->ctrl = (uint8_t*)(table->indices + capacity);
+    table->entry_capacity = entry_capacity;
+    table->capacity = capacity;
+}
 
-        if (pair->key != NULL && pair->key == key) {
-            pair->value = value;
-            return;
+static int find_value_slot(struct ValueTable* table, Value key, uint32_t hash) {
+    if (table->capacity == 0) return -1;
+
+    int group_mask = table->capacity / GROUP_SIZE - 1;
+    int group = HASH_GROUP(hash) & group_mask;
+    for (int step = 1; ; step++) {
+        const uint8_t* ctrl = table->ctrl + group * GROUP_SIZE;
+        uint32_t matches = match_ctrl(ctrl, HASH_CTRL(hash));
+        while (matches != 0) {
+            int slot = group * GROUP_SIZE + lowest_bit(matches);
+            if (same_key(table->entries[table->indices[slot]].key, key)) return slot;
+            matches &= matches - 1;
         }
+        if (match_ctrl(ctrl, CTRL_EMPTY) != 0) return -1;
+        group = NEXT_GROUP(group, step, group_mask);
+    }
+}
 
-        idx = (idx + 1) % table->capacity;
+//see pack_entries
+static void pack_value_entries(struct ValueTable* dest, struct ValueTable* src) {
+    memset(dest->ctrl, CTRL_EMPTY, dest->capacity);
+    int count = 0;
+    for (int i = 0; i < src->entry_count; i++) {
+        struct ValueEntry* entry = &src->entries[i];
+        if (entry->key.type == VAL_NIL) continue;
+        uint32_t hash = value_hash(entry->key);
+        int slot = find_free_slot(dest->ctrl, dest->capacity, hash);
+        dest->ctrl[slot] = HASH_CTRL(hash);
+        dest->indices[slot] = count;
+        dest->entries[count++] = *entry;
     }
+    dest->count = count;
+    dest->entry_count = count;
+    dest->tombstones = 0;
 }
 
+//see rehash_table
+static void rehash_value_table(struct ValueTable* table, int min_count) {
+    if (table->capacity != 0 && min_count * 2 <= table->capacity) {
+        pack_value_entries(table, table);
+        return;
+    }
 
-bool get_entry(struct Table* table, struct ObjString* key, Value* value) {
-    if (table->capacity == 0) return false;
+    int capacity = table->capacity == 0 ? GROUP_SIZE : table->capacity;
+    while (min_count * 2 > capacity) capacity *= 2;
 
-    int idx = key->hash % table->capacity;
-    for (;;) {
-        struct Entry* pair = &table->entries[idx];
-        if (pair->key == NULL && pair->value.type == VAL_NIL) {
-            return false;
-        }
+    struct ValueTable new_table;
+    int entry_capacity = max_entries(capacity);
+    set_value_slots(&new_table, GROW_ARRAY(NULL, uint8_t, slots_size(sizeof(struct ValueEntry), entry_capacity, capacity), 0), entry_capacity, capacity);
+    pack_value_entries(&new_table, table);
 
-        //check if pair->key is NULL to skip tombstones
-        if (pair->key != NULL && pair->key == key) {
-            *value = pair->value;
-            return true;
-        }
+    FREE_ARRAY(table->entries, uint8_t, slots_size(sizeof(struct ValueEntry), table->entry_capacity, table->capacity));
+    *table = new_table;
+}
 
-        idx = (idx + 1) % table->capacity;
-    }
+void init_value_table(struct ValueTable* table) {
+    table->entries = NULL;
+    table->indices = NULL;
+    table->ctrl = NULL;
+    table->count = 0;
+    table->entry_count = 0;
+    table->entry_capacity = 0;
+    table->capacity = 0;
+    table->tombstones = 0;
+}
 
+int free_value_table(struct ValueTable* table) {
+    return FREE_ARRAY(table->entries, uint8_t, slots_size(sizeof(struct ValueEntry), table->entry_capacity, table->capacity));
 }
 
-struct ObjString* find_interned_string(struct Table* table, const char* chars, int length, uint32_t hash) {
-    if (table->capacity == 0) return false;
+//'dest' must be empty, and becomes a copy of 'src' (keys and values as is) in a single allocation
+void clone_value_table(struct ValueTable* dest, struct ValueTable* src) {
+    if (src->capacity == 0) return;
+    int entry_capacity = max_entries(src->capacity);
+    set_value_slots(dest, GROW_ARRAY(NULL, uint8_t, slots_size(sizeof(struct ValueEntry), entry_capacity, src->capacity), 0), entry_capacity, src->capacity);
+    memcpy(dest->entries, src->entries, sizeof(struct ValueEntry) * src->entry_count);
+    memcpy(dest->indices, src->indices, sizeof(int32_t) * src->capacity);
+    memcpy(dest->ctrl, src->ctrl, src->capacity);
+    dest->count = src->count;
+    dest->entry_count = src->entry_count;
+    dest->tombstones = src->tombstones;
+}
 
-    int idx = hash % table->capacity;
-    for (;;) {
-        struct Entry* pair = &table->entries[idx];
-        if (pair->key == NULL && pair->value.type == VAL_NIL) {
-            return NULL;
-        }
+//'dest' is replaced with the entries of 'src', with the values copied (see copy_value)
+void copy_value_table(struct ValueTable* dest, struct ValueTable* src) {
+    free_value_table(dest);
+    init_value_table(dest);
+    if (src->count > 0) rehash_value_table(dest, src->count);
 
-        if (pair->key != NULL &&
-            pair->key->hash == hash &&
-            pair->key->length == length &&
-            memcmp(pair->key->chars, chars, length) == 0) {
-            return pair->key;
-        }
+    int pushed = 0;
+    for (int i = 0; i < src->entry_count; i++) {
+        struct ValueEntry* pair = &src->entries[i];
+        if (pair->key.type == VAL_NIL) continue;
 
-        idx = (idx + 1) % table->capacity;
+        Value copy = copy_value(&pair->value);
+        push_root(copy);
+        pushed++;
+        set_value_entry(dest, pair->key, copy);
     }
 
+    for (int i = 0; i < pushed; i++) {
+        pop_root();
+    }
 }
 
+//Removes every entry but keeps the slots for reuse
+void clear_value_table(struct ValueTable* table) {
+    if (table->capacity != 0) memset(table->ctrl, CTRL_EMPTY, table->capacity);
+    table->count = 0;
+    table->entry_count = 0;
+    table->tombstones = 0;
+}
 
-void delete_entry(struct Table* table, struct ObjString* key) {
-    int idx = key->hash % table->capacity;
-    for (;;) {
-        struct Entry* pair = &table->entries[idx];
-        if (pair->key == NULL && pair->value.type == VAL_NIL) {
-            return;
-        }
-
+//makes room for at least 'count' entries up front
+void reserve_value_table(struct ValueTable* table, int count) {
+    if (count > table->entry_capacity) rehash_value_table(table, count);
+}
 
-        if (pair->key != NULL && pair->key == key) {
-            //tombstone is 'NULL' key and 'true' value
-            table->entries[idx].key = NULL;
-            table->entries[idx].value = to_boolean(true);
-            return;
-        }
+//returns false if 'key' was already in the table (and only its value was replaced)
+bool set_value_entry(struct ValueTable* table, Value key, Value value) {
+    uint32_t hash = value_hash(key);
+    int slot = find_value_slot(table, key, hash);
+    if (slot != -1) {
+        table->entries[table->indices[slot]].value = value;
+        return false;
+    }
 
-        idx = (idx + 1) % table->capacity;
+    if (table->entry_count == table->entry_capacity || table->tombstones > MAX_TOMBSTONES(table->capacity)) {
+        rehash_value_table(table, table->count + 1);
     }
 
+    slot = find_free_slot(table->ctrl, table->capacity, hash);
+    if (table->ctrl[slot] == CTRL_DELETED) table->tombstones--;
+    table->ctrl[slot] = HASH_CTRL(hash);
+    table->indices[slot] = table->entry_count;
+    table->entries[table->entry_count].key = key;
+    table->entries[table->entry_count].value = value;
+    table->entry_count++;
+    table->count++;
+    return true;
 }
 
-void print_table(struct Table* table) {
-    printf("Table count: %d, Table capacity: %d \n", table->count, table->capacity);
-    for (int i = 0; i < table->capacity; i++) {
-        struct Entry* pair = &table->entries[i];
-        printf("[%d] ", i);
-        if (pair->key != NULL) {
-            printf("Key: %.*s, Value: ", pair->key->length, pair->key->chars);
-            print_value(pair->value);
-            printf("\n");
-        } else {
-            if (pair->value.type == VAL_BOOL && pair->value.as.boolean_type) {
-                printf("tombstone\n");
-            } else {
-                printf("NULL\n");
-            }
-        }
-    }
+bool get_value_entry(struct ValueTable* table, Value key, Value* value) {
+    int slot = find_value_slot(table, key, value_hash(key));
+    if (slot == -1) return false;
+    *value = table->entries[table->indices[slot]].value;
+    return true;
 }
 
+//Like delete_entry, the entry is left in place with a nil key.  Returns false if 'key' wasn't
+//in the table.
+bool delete_value_entry(struct ValueTable* table, Value key) {
+    int slot = find_value_slot(table, key, value_hash(key));
+    if (slot == -1) return false;
+
+    const uint8_t* group = table->ctrl + (slot / GROUP_SIZE) * GROUP_SIZE;
+    if (match_ctrl(group, CTRL_EMPTY) != 0) {
+        table->ctrl[slot] = CTRL_EMPTY;
+    } else {
+        table->ctrl[slot] = CTRL_DELETED;
+        table->tombstones++;
+    }
 
+    struct ValueEntry* entry = &table->entries[table->indices[slot]];
+    entry->key = to_nil();
+    entry->value = to_nil();
+    table->count--;
+    return true;
+}
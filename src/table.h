@@ -1,6 +1,7 @@
 #ifndef CEBRA_TABLE_H
 #define CEBRA_TABLE_H
 
+#include <stdint.h>
 #include "value.h"
 
 struct ObjString;
@@ -10,10 +11,26 @@ struct Entry {
     Value value;
 };
 
+//A compact dict: 'entries' holds the first 'entry_count' entries densely, in insertion order
+//(removed entries are left in place with a NULL key until the next rehash), so walking a table
+//is a linear scan over entries[0..entry_count).
+//
+//Lookups go through a hash index in the style of SwissTable: 'ctrl' holds one byte per slot -
+//empty, deleted, or 7 bits of the key's hash - and 'indices' the position of the slot's entry.
+//Lookups compare 16 control bytes at once before looking at any keys.  'capacity' (the number
+//of slots) is 0 or a power of two (at least 16).
+//
+//'tombstones' counts the deleted slots, which lengthen probes.  Once there are too many the
+//next insert packs the table in place.
 struct Table {
     struct Entry* entries;
+    int32_t* indices;
+    uint8_t* ctrl;
     int count;
+    int entry_count;
+    int entry_capacity;
     int capacity;
+    int tombstones;
 };
 
 void init_table(struct Table* table);
@@ -21,8 +38,41 @@ void set_entry(struct Table* table, struct ObjString* key, Value value);
 bool get_entry(struct Table* table, struct ObjString* key, Value* value);
 void delete_entry(struct Table* table, struct ObjString* key);
 void copy_table(struct Table* dest, struct Table* src);
+size_t table_bytes(struct Table* table);
+void copy_table_into(struct Table* dest, struct Table* src, void* slots);
+void clone_table(struct Table* dest, struct Table* src);
 int free_table(struct Table* table);
 void print_table(struct Table* table);
 struct ObjString* find_interned_string(struct Table* table, const char* chars, int length, uint32_t hash);
 
+struct ValueEntry {
+    Value key;
+    Value value;
+};
+
+//A Table keyed by ints, bytes, bools or strings (flat strings or views) instead of only strings,
+//for Maps and Sets.  The layout and probing are the same, removed entries are left in place with
+//a nil key.  Ints, bytes and bools use multiplicative hashing.
+struct ValueTable {
+    struct ValueEntry* entries;
+    int32_t* indices;
+    uint8_t* ctrl;
+    int count;
+    int entry_count;
+    int entry_capacity;
+    int capacity;
+    int tombstones;
+};
+
+uint32_t value_hash(Value key);
+void init_value_table(struct ValueTable* table);
+int free_value_table(struct ValueTable* table);
+void clone_value_table(struct ValueTable* dest, struct ValueTable* src);
+void clear_value_table(struct ValueTable* table);
+void copy_value_table(struct ValueTable* dest, struct ValueTable* src);
+void reserve_value_table(struct ValueTable* table, int count);
+bool set_value_entry(struct ValueTable* table, Value key, Value value);
+bool get_value_entry(struct ValueTable* table, Value key, Value* value);
+bool delete_value_entry(struct ValueTable* table, Value key);
+
 #endif // CEBRA_TABLE_H
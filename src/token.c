@@ -53,6 +53,7 @@ void print_token(Token token) {
         case TOKEN_RIGHT_BRACKET: printf("TOKEN_RIGHT_BRACKET"); break;
         case TOKEN_IN: printf("TOKEN_IN"); break;
         case TOKEN_MAP: printf("TOKEN_MAP"); break;
+        case TOKEN_SET: printf("TOKEN_SET"); break;
         case TOKEN_NIL: printf("TOKEN_NIL"); break;
         case TOKEN_FOR_EACH: printf("TOKEN_FOR_EACH"); break;
         case TOKEN_ENUM: printf("TOKEN_ENUM"); break;
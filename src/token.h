@@ -14,6 +14,9 @@ typedef enum {
     TOKEN_BOOL_TYPE,
     TOKEN_BYTE_TYPE,
     TOKEN_FILE_TYPE,
+    TOKEN_STRING_BUILDER_TYPE,
+    TOKEN_TENSOR_TYPE,
+    TOKEN_BYTES_TYPE,
     TOKEN_NIL_TYPE,
     TOKEN_TRUE,
     TOKEN_FALSE,
@@ -55,6 +58,7 @@ typedef enum {
     TOKEN_RIGHT_BRACKET,
     TOKEN_IN,
     TOKEN_MAP,
+    TOKEN_SET,
     TOKEN_NIL,
     TOKEN_FOR_EACH,
     TOKEN_ENUM,
@@ -2,8 +2,23 @@
 #include <string.h>
 #include "type.h"
 #include "memory.h"
+#include "arena.h"
 #include "compiler.h"
 
+//primitive types carry no data, so every literal/declaration shares one instance.
+//Never set 'opt' on these - use copy_type() to get a private instance first.
+static struct TypeInt int_type = {{TYPE_INT, NULL, NULL}};
+static struct TypeFloat float_type = {{TYPE_FLOAT, NULL, NULL}};
+static struct TypeBool bool_type = {{TYPE_BOOL, NULL, NULL}};
+static struct TypeByte byte_type = {{TYPE_BYTE, NULL, NULL}};
+static struct TypeString string_type = {{TYPE_STRING, NULL, NULL}};
+static struct TypeNil nil_type = {{TYPE_NIL, NULL, NULL}};
+static struct TypeFile file_type = {{TYPE_FILE, NULL, NULL}};
+static struct TypeStringBuilder string_builder_type = {{TYPE_STRING_BUILDER, NULL, NULL}};
+static struct TypeTensor tensor_type = {{TYPE_TENSOR, NULL, NULL}};
+static struct TypeBytes bytes_type = {{TYPE_BYTES, NULL, NULL}};
+static struct TypeInfer infer_type = {{TYPE_INFER, NULL, NULL}};
+
 void insert_type(struct Type* type) {
     type->next = current_compiler->types;
     type->opt = NULL;
@@ -13,7 +28,7 @@ void insert_type(struct Type* type) {
 void add_type(struct TypeArray* sl, struct Type* type) {
     if (sl->count + 1 > sl->capacity) {
         int new_capacity = sl->capacity == 0 ? 8 : sl->capacity * 2;
-        sl->types = GROW_ARRAY(sl->types, struct Type*, new_capacity, sl->capacity);
+        sl->types = ARENA_GROW_ARRAY(current_compiler->arena, sl->types, struct Type*, new_capacity, sl->capacity);
         sl->capacity = new_capacity;
     }
 
@@ -22,7 +37,7 @@ void add_type(struct TypeArray* sl, struct Type* type) {
 }
 
 struct Type* make_decl_type(struct Type* custom_type) {
-    struct TypeDecl* td = ALLOCATE(struct TypeDecl);
+    struct TypeDecl* td = ARENA_ALLOCATE(current_compiler->arena, struct TypeDecl);
     td->custom_type = custom_type;
     td->base.type = TYPE_DECL;
 
@@ -31,26 +46,28 @@ struct Type* make_decl_type(struct Type* custom_type) {
 }
 
 struct Type* make_file_type() {
-    struct TypeFile* tf = ALLOCATE(struct TypeFile);
-
-    tf->base.type = TYPE_FILE;
+    return (struct Type*)&file_type;
+}
 
-    insert_type((struct Type*)tf);
-    return (struct Type*)tf;
+struct Type* make_string_builder_type() {
+    return (struct Type*)&string_builder_type;
 }
 
-struct Type* make_infer_type() {
-    struct TypeInfer* sd = ALLOCATE(struct TypeInfer);
+struct Type* make_tensor_type() {
+    return (struct Type*)&tensor_type;
+}
 
-    sd->base.type = TYPE_INFER;
+struct Type* make_bytes_type() {
+    return (struct Type*)&bytes_type;
+}
 
-    insert_type((struct Type*)sd);
-    return (struct Type*)sd;
+struct Type* make_infer_type() {
+    return (struct Type*)&infer_type;
 }
 
 struct TypeArray* make_type_array() {
-    struct TypeArray* type_list = ALLOCATE(struct TypeArray);
-    type_list->types = ALLOCATE_ARRAY(struct Type*);
+    struct TypeArray* type_list = ARENA_ALLOCATE(current_compiler->arena, struct TypeArray);
+    type_list->types = NULL;
     type_list->count = 0;
     type_list->capacity = 0;
 
@@ -61,60 +78,30 @@ struct TypeArray* make_type_array() {
 }
 
 struct Type* make_int_type() {
-    struct TypeInt* type = ALLOCATE(struct TypeInt);
-
-    type->base.type = TYPE_INT;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&int_type;
 }
 
 struct Type* make_float_type() {
-    struct TypeFloat* type = ALLOCATE(struct TypeFloat);
-
-    type->base.type = TYPE_FLOAT;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&float_type;
 }
 
 struct Type* make_bool_type() {
-    struct TypeBool* type = ALLOCATE(struct TypeBool);
-
-    type->base.type = TYPE_BOOL;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&bool_type;
 }
 
 struct Type* make_byte_type() {
-    struct TypeByte* type = ALLOCATE(struct TypeByte);
-
-    type->base.type = TYPE_BYTE;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&byte_type;
 }
 
 struct Type* make_string_type() {
-    struct TypeString* type = ALLOCATE(struct TypeString);
-
-    type->base.type = TYPE_STRING;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&string_type;
 }
 struct Type* make_nil_type() {
-    struct TypeNil* type = ALLOCATE(struct TypeNil);
-
-    type->base.type = TYPE_NIL;
-    
-    insert_type((struct Type*)type);
-    return (struct Type*)type;
+    return (struct Type*)&nil_type;
 }
 
 struct Type* make_fun_type(struct TypeArray* params, struct TypeArray* returns) {
-    struct TypeFun* type_fun = ALLOCATE(struct TypeFun);
+    struct TypeFun* type_fun = ARENA_ALLOCATE(current_compiler->arena, struct TypeFun);
 
     type_fun->base.type = TYPE_FUN;
     type_fun->params = params;
@@ -125,7 +112,7 @@ struct Type* make_fun_type(struct TypeArray* params, struct TypeArray* returns)
 }
 
 struct Type* make_struct_type(Token name, struct Type* super) {
-    struct TypeStruct* sc = ALLOCATE(struct TypeStruct);
+    struct TypeStruct* sc = ARENA_ALLOCATE(current_compiler->arena, struct TypeStruct);
 
     sc->base.type = TYPE_STRUCT;
     sc->name = name;
@@ -137,7 +124,7 @@ struct Type* make_struct_type(Token name, struct Type* super) {
 }
 
 struct Type* make_identifier_type(Token identifier) {
-    struct TypeIdentifier* si = ALLOCATE(struct TypeIdentifier);
+    struct TypeIdentifier* si = ARENA_ALLOCATE(current_compiler->arena, struct TypeIdentifier);
 
     si->base.type = TYPE_IDENTIFIER;
     si->identifier = identifier;
@@ -147,7 +134,7 @@ struct Type* make_identifier_type(Token identifier) {
 }
 
 struct Type* make_list_type(struct Type* type) {
-    struct TypeList* sl = ALLOCATE(struct TypeList);
+    struct TypeList* sl = ARENA_ALLOCATE(current_compiler->arena, struct TypeList);
 
     sl->base.type = TYPE_LIST;
     sl->type = type;
@@ -156,18 +143,29 @@ struct Type* make_list_type(struct Type* type) {
     return (struct Type*)sl;
 }
 
-struct Type* make_map_type(struct Type* type) {
-    struct TypeMap* sm = ALLOCATE(struct TypeMap);
+struct Type* make_map_type(struct Type* key_type, struct Type* type) {
+    struct TypeMap* sm = ARENA_ALLOCATE(current_compiler->arena, struct TypeMap);
 
     sm->base.type = TYPE_MAP;
+    sm->key_type = key_type;
     sm->type = type;
 
     insert_type((struct Type*)sm);
     return (struct Type*)sm;
 }
 
+struct Type* make_set_type(struct Type* type) {
+    struct TypeSet* ts = ARENA_ALLOCATE(current_compiler->arena, struct TypeSet);
+
+    ts->base.type = TYPE_SET;
+    ts->type = type;
+
+    insert_type((struct Type*)ts);
+    return (struct Type*)ts;
+}
+
 struct Type* make_enum_type(Token name) {
-    struct TypeEnum* te = ALLOCATE(struct TypeEnum);
+    struct TypeEnum* te = ARENA_ALLOCATE(current_compiler->arena, struct TypeEnum);
 
     te->base.type = TYPE_ENUM;
     te->name = name;
@@ -248,7 +246,12 @@ bool same_type(struct Type* type1, struct Type* type2) {
             return same_type(((struct TypeList*)type1)->type, ((struct TypeList*)type2)->type);
         }
         case TYPE_MAP: {
-            return same_type(((struct TypeMap*)type1)->type, ((struct TypeMap*)type2)->type);
+            struct TypeMap* tm1 = (struct TypeMap*)type1;
+            struct TypeMap* tm2 = (struct TypeMap*)type2;
+            return same_type(tm1->key_type, tm2->key_type) && same_type(tm1->type, tm2->type);
+        }
+        case TYPE_SET: {
+            return same_type(((struct TypeSet*)type1)->type, ((struct TypeSet*)type2)->type);
         }
         case TYPE_ENUM: {
             struct TypeEnum* te1 = (struct TypeEnum*)type1;
@@ -281,6 +284,18 @@ void print_type(struct Type* type) {
             printf("TypeFile");
             break;
         }
+        case TYPE_STRING_BUILDER: {
+            printf("TypeStringBuilder");
+            break;
+        }
+        case TYPE_TENSOR: {
+            printf("TypeTensor");
+            break;
+        }
+        case TYPE_BYTES: {
+            printf("TypeBytes");
+            break;
+        }
         case TYPE_ARRAY: {
             struct TypeArray* sl = (struct TypeArray*)type;
             printf("(TypeArray: ");
@@ -328,6 +343,10 @@ void print_type(struct Type* type) {
             printf("TypeMap Stub");
             break;
         }
+        case TYPE_SET: {
+            printf("TypeSet Stub");
+            break;
+        }
         case TYPE_INT: {
             printf("TypeInt stub");
             break;
@@ -359,90 +378,72 @@ void print_type(struct Type* type) {
     }
 }
 
-void free_type(struct Type* type) {
+static size_t type_size(TypeType type) {
+    switch(type) {
+        case TYPE_INT: return sizeof(struct TypeInt);
+        case TYPE_FLOAT: return sizeof(struct TypeFloat);
+        case TYPE_BOOL: return sizeof(struct TypeBool);
+        case TYPE_BYTE: return sizeof(struct TypeByte);
+        case TYPE_STRING: return sizeof(struct TypeString);
+        case TYPE_NIL: return sizeof(struct TypeNil);
+        case TYPE_ARRAY: return sizeof(struct TypeArray);
+        case TYPE_FUN: return sizeof(struct TypeFun);
+        case TYPE_STRUCT: return sizeof(struct TypeStruct);
+        case TYPE_IDENTIFIER: return sizeof(struct TypeIdentifier);
+        case TYPE_LIST: return sizeof(struct TypeList);
+        case TYPE_MAP: return sizeof(struct TypeMap);
+        case TYPE_SET: return sizeof(struct TypeSet);
+        case TYPE_INFER: return sizeof(struct TypeInfer);
+        case TYPE_ENUM: return sizeof(struct TypeEnum);
+        case TYPE_DECL: return sizeof(struct TypeDecl);
+        case TYPE_FILE: return sizeof(struct TypeFile);
+        case TYPE_STRING_BUILDER: return sizeof(struct TypeStringBuilder);
+        case TYPE_TENSOR: return sizeof(struct TypeTensor);
+        case TYPE_BYTES: return sizeof(struct TypeBytes);
+    }
+    return sizeof(struct Type);
+}
+
+//shallow copy with its own 'opt' link (inner types and type arrays are shared)
+struct Type* copy_type(struct Type* type) {
+    size_t size = type_size(type->type);
+    struct Type* copy = (struct Type*)arena_alloc(current_compiler->arena, size);
+    memcpy(copy, type, size);
     switch(type->type) {
-        case TYPE_INFER: {
-            struct TypeInfer* sd = (struct TypeInfer*)type;
-            FREE(sd, struct TypeInfer);
-            break;
-        }
-        case TYPE_DECL: {
-            struct TypeDecl* sd = (struct TypeDecl*)type;
-            FREE(sd, struct TypeDecl);
-            break;
-        }
-        case TYPE_FILE: {
-            struct TypeFile* tf = (struct TypeFile*)type;
-            FREE(tf, struct TypeFile);
+        case TYPE_STRUCT: {
+            struct TypeStruct* sc = (struct TypeStruct*)copy;
+            init_table(&sc->props);
+            copy_table(&sc->props, &((struct TypeStruct*)type)->props);
             break;
         }
-        case TYPE_ARRAY: {
-            struct TypeArray* sa = (struct TypeArray*)type;
-            FREE_ARRAY(sa->types, struct Type*, sa->capacity);
-            FREE(sa, struct TypeArray);
+        case TYPE_ENUM: {
+            struct TypeEnum* te = (struct TypeEnum*)copy;
+            init_table(&te->props);
+            copy_table(&te->props, &((struct TypeEnum*)type)->props);
             break;
         }
-        case TYPE_FUN: {
-            struct TypeFun* type_fun = (struct TypeFun*)type;
-            FREE(type_fun, struct TypeFun);
+        default:
             break;
-        }
+    }
+
+    insert_type(copy);
+    return copy;
+}
+
+//the type itself lives in the compiler arena - only the props tables are on the GC heap
+void free_type(struct Type* type) {
+    switch(type->type) {
         case TYPE_STRUCT: {
             struct TypeStruct* sc = (struct TypeStruct*)type;
             free_table(&sc->props);
-            FREE(sc, struct TypeStruct);
             break;
         }
         case TYPE_ENUM: {
             struct TypeEnum* te = (struct TypeEnum*)type;
             free_table(&te->props);
-            FREE(te, struct TypeEnum);
-            break;
-        }
-        case TYPE_IDENTIFIER: {
-            struct TypeIdentifier* si = (struct TypeIdentifier*)type;
-            FREE(si, struct TypeIdentifier);
             break;
         }
-        case TYPE_LIST: {
-            struct TypeList* sl = (struct TypeList*)type;
-            FREE(sl, struct TypeList);
-            break;
-        }
-        case TYPE_MAP: {
-            struct TypeMap* sm = (struct TypeMap*)type;
-            FREE(sm, struct TypeMap);
-            break;
-        }
-        case TYPE_INT: {
-            struct TypeInt* type_int = (struct TypeInt*)type;
-            FREE(type_int, struct TypeInt);
-            break;
-        }
-        case TYPE_FLOAT: {
-            struct TypeFloat* type_float = (struct TypeFloat*)type;
-            FREE(type_float, struct TypeFloat);
-            break;
-        }
-        case TYPE_BOOL: {
-            struct TypeBool* type_bool = (struct TypeBool*)type;
-            FREE(type_bool, struct TypeBool);
-            break;
-        }
-        case TYPE_BYTE: {
-            struct TypeByte* type_byte = (struct TypeByte*)type;
-            FREE(type_byte, struct TypeByte);
-            break;
-        }
-        case TYPE_STRING: {
-            struct TypeString* type_string = (struct TypeString*)type;
-            FREE(type_string, struct TypeString);
-            break;
-        }
-        case TYPE_NIL: {
-            struct TypeNil* type_nil = (struct TypeNil*)type;
-            FREE(type_nil, struct TypeNil);
+        default:
             break;
-        }
     }
 }
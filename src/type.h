@@ -20,7 +20,11 @@ typedef enum {
     TYPE_INFER,
     TYPE_ENUM,
     TYPE_DECL, //User defined type to check for this invalid syntax: a := Dog (where Dog is a struct)
-    TYPE_FILE
+    TYPE_FILE,
+    TYPE_STRING_BUILDER,
+    TYPE_TENSOR,
+    TYPE_SET,
+    TYPE_BYTES
 } TypeType;
 
 struct Type {
@@ -42,6 +46,19 @@ struct TypeFile {
     struct Type base;
 };
 
+struct TypeStringBuilder {
+    struct Type base;
+};
+
+//only Tensor<float> for now
+struct TypeTensor {
+    struct Type base;
+};
+
+struct TypeBytes {
+    struct Type base;
+};
+
 struct TypeArray {
     struct Type base;
     struct Type** types;
@@ -102,7 +119,14 @@ struct TypeList {
     struct Type* type;
 };
 
+//'type' is the value type.  Map<T> has string keys.
 struct TypeMap {
+    struct Type base;
+    struct Type* key_type;
+    struct Type* type;
+};
+
+struct TypeSet {
     struct Type base;
     struct Type* type;
 };
@@ -122,11 +146,15 @@ struct Type* make_fun_type(struct TypeArray* params, struct TypeArray* returns);
 struct Type* make_struct_type(Token name, struct Type* super);
 struct Type* make_identifier_type(Token identifier);
 struct Type* make_list_type(struct Type* type);
-struct Type* make_map_type(struct Type* type);
+struct Type* make_map_type(struct Type* key_type, struct Type* type);
+struct Type* make_set_type(struct Type* type);
 struct Type* make_infer_type();
 struct Type* make_enum_type(Token name);
 struct Type* make_decl_type(struct Type* custom_type);
 struct Type* make_file_type();
+struct Type* make_string_builder_type();
+struct Type* make_tensor_type();
+struct Type* make_bytes_type();
 
 bool is_substruct(struct TypeStruct* substruct, struct TypeStruct* superstruct);
 bool same_type(struct Type* type1, struct Type* type2);
@@ -90,6 +90,34 @@ Value to_file(struct ObjFile* obj) {
     return value;
 }
 
+Value to_string_builder(struct ObjStringBuilder* obj) {
+    Value value;
+    value.type = VAL_STRING_BUILDER;
+    value.as.string_builder_type = obj;
+    return value;
+}
+
+Value to_tensor(struct ObjTensor* obj) {
+    Value value;
+    value.type = VAL_TENSOR;
+    value.as.tensor_type = obj;
+    return value;
+}
+
+Value to_set(struct ObjSet* obj) {
+    Value value;
+    value.type = VAL_SET;
+    value.as.set_type = obj;
+    return value;
+}
+
+Value to_bytes(struct ObjBytes* obj) {
+    Value value;
+    value.type = VAL_BYTES;
+    value.as.bytes_type = obj;
+    return value;
+}
+
 Value to_nil(void) {
     Value value;
     value.type = VAL_NIL;
@@ -162,10 +190,19 @@ Value equal_values(Value a, Value b) {
             return to_boolean(a.as.integer_type == b.as.integer_type);
         case VAL_FLOAT:
             return to_boolean(a.as.float_type == b.as.float_type);
-        case VAL_STRING:
-            return to_boolean(a.as.string_type == b.as.string_type);
+        case VAL_STRING: {
+            push_root(b);
+            struct ObjString* left = flatten_string(a.as.string_type);
+            pop_root();
+            push_root(to_string(left));
+            struct ObjString* right = flatten_string(b.as.string_type);
+            pop_root();
+            return to_boolean(same_string(left, right));
+        }
         case VAL_BOOL:
             return to_boolean(a.as.boolean_type == b.as.boolean_type);
+        case VAL_BYTE:
+            return to_boolean(a.as.byte_type == b.as.byte_type);
         case VAL_NIL:
             return to_boolean(true);
         default:
@@ -175,25 +212,22 @@ Value equal_values(Value a, Value b) {
 
 static Value cast_to_string(Value* value) {
     switch(value->type) {
-        case VAL_INT: {
-            int num = value->as.integer_type;
+        case VAL_INT:
+        case VAL_BYTE: {
+            int num = value->type == VAL_INT ? value->as.integer_type : value->as.byte_type;
 
-            char* str = ALLOCATE_ARRAY(char);
-            str = GROW_ARRAY(str, char, 80, 0);
+            char str[80];
             int len = sprintf(str, "%d", num);
-            str = GROW_ARRAY(str, char, len + 1, 80);
 
-            return to_string(take_string(str, len));
+            return to_string(make_transient_string(str, len));
         }
         case VAL_FLOAT: {
             double num = value->as.float_type;
 
-            char* str = ALLOCATE_ARRAY(char);
-            str = GROW_ARRAY(str, char, 80, 0);
+            char str[400]; //%f of DBL_MAX is over 300 chars
             int len = sprintf(str, "%f", num);
-            str = GROW_ARRAY(str, char, len + 1, 80);
 
-            return to_string(take_string(str, len));
+            return to_string(make_transient_string(str, len));
         }
         case VAL_BOOL:
             if (value->as.boolean_type) {
@@ -233,10 +267,14 @@ static Value cast_to_byte(Value* value) {
             uint8_t i = (uint8_t)strtol(value->as.string_type->chars, &end, 10);
             return to_byte(i);
         }
+        case VAL_INT:
+            return to_byte((uint8_t)(value->as.integer_type));
+        case VAL_BYTE:
+            return *value;
         case VAL_FLOAT:
             return to_byte((uint8_t)(value->as.float_type));
         case VAL_BOOL:
-            if (value->as.boolean_type) return to_integer(1);
+            if (value->as.boolean_type) return to_byte(1);
             return to_byte(0);
         default:
             return to_nil();
@@ -280,6 +318,10 @@ static Value cast_to_bool(Value* value) {
 }
 
 Value cast_primitive(ValueType to_type, Value* value) {
+    if (value->type == VAL_STRING) {
+        value->as.string_type = materialize_string(value->as.string_type);
+    }
+
     switch(to_type) {
         case VAL_STRING:
             return cast_to_string(value);
@@ -313,7 +355,7 @@ void print_value(Value a) {
             printf("%d", a.as.byte_type);
             break;
         case VAL_STRING:
-            printf("<string %s >", a.as.string_type->chars);
+            printf("<string %s >", materialize_string(a.as.string_type)->chars);
             break;
         case VAL_FUNCTION:
             printf("%s", "<fun: ");
@@ -350,6 +392,18 @@ void print_value(Value a) {
         case VAL_FILE:
             printf("%s", "<file>");
             break;
+        case VAL_STRING_BUILDER:
+            printf("%s", "<string builder>");
+            break;
+        case VAL_TENSOR:
+            printf("%s", "<tensor>");
+            break;
+        case VAL_SET:
+            printf("%s", "<set>");
+            break;
+        case VAL_BYTES:
+            printf("%s", "<bytes>");
+            break;
         default:
             printf("Invalid value");
             break;
@@ -373,6 +427,10 @@ const char* value_type_to_string(ValueType type) {
         case VAL_MAP: return "VAL_MAP";
         case VAL_ENUM: return "VAL_ENUM";
         case VAL_FILE: return "VAL_FILE";
+        case VAL_STRING_BUILDER: return "VAL_STRING_BUILDER";
+        case VAL_TENSOR: return "VAL_TENSOR";
+        case VAL_SET: return "VAL_SET";
+        case VAL_BYTES: return "VAL_BYTES";
         default: return "Unrecognized VAL_TYPE";
     }
 }
@@ -415,6 +473,22 @@ struct Obj* get_object(Value* value) {
             struct ObjFile* obj = value->as.file_type;
             return (struct Obj*)obj;
         }
+        case VAL_STRING_BUILDER: {
+            struct ObjStringBuilder* obj = value->as.string_builder_type;
+            return (struct Obj*)obj;
+        }
+        case VAL_TENSOR: {
+            struct ObjTensor* obj = value->as.tensor_type;
+            return (struct Obj*)obj;
+        }
+        case VAL_SET: {
+            struct ObjSet* obj = value->as.set_type;
+            return (struct Obj*)obj;
+        }
+        case VAL_BYTES: {
+            struct ObjBytes* obj = value->as.bytes_type;
+            return (struct Obj*)obj;
+        }
         //Values with stack allocated data
         //don't need to be garbage collected
         case VAL_INT:
@@ -431,27 +505,22 @@ struct Obj* get_object(Value* value) {
 Value copy_value(Value* value) {
     switch (value->type) {
         case VAL_MAP: {
-            struct ObjMap* orig_map = value->as.map_type;
-            struct ObjMap* map = make_map();
-            push_root(to_map(map));
-            copy_table(&map->table, &orig_map->table);
-            pop_root();
-            return to_map(map);
+            return to_map(copy_map(value->as.map_type));
         }
         case VAL_LIST: {
-            struct ObjList* orig_list = value->as.list_type;
-            struct ObjList* list = make_list();
-            push_root(to_list(list));
-            copy_value_array(&list->values, &orig_list->values);
-            pop_root();
-            return to_list(list);
+            return to_list(copy_list(value->as.list_type));
+        }
+        case VAL_SET: {
+            return to_set(copy_set(value->as.set_type));
+        }
+        case VAL_STRING_BUILDER: {
+            return to_string_builder(copy_string_builder(value->as.string_builder_type));
+        }
+        case VAL_TENSOR: {
+            return to_tensor(copy_tensor(value->as.tensor_type));
         }
         case VAL_STRING: {
-            struct ObjString* orig_str = value->as.string_type;
-            push_root(to_string(orig_str));
-            struct ObjString* str = make_string(orig_str->chars, orig_str->length);
-            pop_root();
-            return to_string(str);
+            return to_string(flatten_string(value->as.string_type));
         }
         default:
             return *value;
@@ -12,8 +12,12 @@ struct ObjString;
 struct ObjNative;
 struct ObjList;
 struct ObjMap;
+struct ObjSet;
 struct ObjEnum;
 struct ObjFile;
+struct ObjStringBuilder;
+struct ObjTensor;
+struct ObjBytes;
 
 typedef enum {
     VAL_INT,
@@ -30,7 +34,11 @@ typedef enum {
     VAL_LIST,
     VAL_MAP,
     VAL_ENUM,
-    VAL_FILE
+    VAL_FILE,
+    VAL_STRING_BUILDER,
+    VAL_TENSOR,
+    VAL_SET,
+    VAL_BYTES
 } ValueType;
 
 typedef struct {
@@ -50,6 +58,10 @@ typedef struct {
         struct ObjMap* map_type;
         struct ObjEnum* enum_type;
         struct ObjFile* file_type;
+        struct ObjStringBuilder* string_builder_type;
+        struct ObjTensor* tensor_type;
+        struct ObjSet* set_type;
+        struct ObjBytes* bytes_type;
     } as;
 } Value;
 
@@ -68,6 +80,10 @@ Value to_list(struct ObjList* obj);
 Value to_map(struct ObjMap* obj);
 Value to_enum(struct ObjEnum* obj);
 Value to_file(struct ObjFile* obj);
+Value to_string_builder(struct ObjStringBuilder* obj);
+Value to_tensor(struct ObjTensor* obj);
+Value to_set(struct ObjSet* obj);
+Value to_bytes(struct ObjBytes* obj);
 Value to_nil(void);
 Value subtract_values(Value a, Value b);
 Value multiply_values(Value a, Value b);
@@ -0,0 +1,410 @@
+#include <stddef.h>
+
+#include "common.h"
+#include "vector.h"
+
+#ifdef THREADED_MATMUL
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECTOR_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Scalar kernels - also used for the tails of the SIMD kernels
+ */
+
+static double sum_scalar(const double* x, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += x[i];
+    return sum;
+}
+
+static double dot_scalar(const double* x, const double* y, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += x[i] * y[i];
+    return sum;
+}
+
+static void axpy_scalar(double a, const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+static void scale_scalar(double a, double* x, int n) {
+    for (int i = 0; i < n; i++) x[i] *= a;
+}
+
+static void op_scalar(VectorOp op, double* y, const double* x, int n) {
+    switch (op) {
+        case VECTOR_ADD: for (int i = 0; i < n; i++) y[i] += x[i]; break;
+        case VECTOR_SUB: for (int i = 0; i < n; i++) y[i] -= x[i]; break;
+        case VECTOR_MUL: for (int i = 0; i < n; i++) y[i] *= x[i]; break;
+        case VECTOR_DIV: for (int i = 0; i < n; i++) y[i] /= x[i]; break;
+    }
+}
+
+//division is never vectorized since it needs a check for zero.  The other operations are done
+//on uint32_t so that overflow wraps the same way it does in the SIMD kernels
+static void op_int_scalar(VectorOp op, int32_t* y, const int32_t* x, int n) {
+    switch (op) {
+        case VECTOR_ADD: for (int i = 0; i < n; i++) y[i] = (int32_t)((uint32_t)y[i] + (uint32_t)x[i]); break;
+        case VECTOR_SUB: for (int i = 0; i < n; i++) y[i] = (int32_t)((uint32_t)y[i] - (uint32_t)x[i]); break;
+        case VECTOR_MUL: for (int i = 0; i < n; i++) y[i] = (int32_t)((uint32_t)y[i] * (uint32_t)x[i]); break;
+        case VECTOR_DIV: for (int i = 0; i < n; i++) y[i] /= x[i]; break;
+    }
+}
+
+/*
+ * SSE2 kernels - always available on x86-64
+ */
+
+#if defined(VECTOR_X86) && defined(__SSE2__)
+
+static double sum_sse2(const double* x, int n) {
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_loadu_pd(x + i));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + sum_scalar(x + i, n - i);
+}
+
+static double dot_sse2(const double* x, const double* y, int n) {
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + dot_scalar(x + i, y + i, n - i);
+}
+
+static void axpy_sse2(double a, const double* x, double* y, int n) {
+    __m128d va = _mm_set1_pd(a);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+    }
+    axpy_scalar(a, x + i, y + i, n - i);
+}
+
+static void scale_sse2(double a, double* x, int n) {
+    __m128d va = _mm_set1_pd(a);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(x + i, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+    scale_scalar(a, x + i, n - i);
+}
+
+#define SSE2_LOOP(intrinsic) \
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, intrinsic(_mm_loadu_pd(y + i), _mm_loadu_pd(x + i)))
+
+static void op_sse2(VectorOp op, double* y, const double* x, int n) {
+    int i = 0;
+    switch (op) {
+        case VECTOR_ADD: SSE2_LOOP(_mm_add_pd); break;
+        case VECTOR_SUB: SSE2_LOOP(_mm_sub_pd); break;
+        case VECTOR_MUL: SSE2_LOOP(_mm_mul_pd); break;
+        case VECTOR_DIV: SSE2_LOOP(_mm_div_pd); break;
+    }
+    op_scalar(op, y + i, x + i, n - i);
+}
+
+#endif
+
+/*
+ * AVX2 kernels - compiled for avx2 regardless of the build flags, and only called
+ * when the cpu supports them
+ */
+
+#ifdef VECTOR_X86
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double sum_avx2(const double* x, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_loadu_pd(x + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(x + i, n - i);
+}
+
+AVX2 static double dot_avx2(const double* x, const double* y, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_scalar(x + i, y + i, n - i);
+}
+
+AVX2 static void axpy_avx2(double a, const double* x, double* y, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, _mm256_loadu_pd(x + i))));
+    }
+    axpy_scalar(a, x + i, y + i, n - i);
+}
+
+AVX2 static void scale_avx2(double a, double* x, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+    scale_scalar(a, x + i, n - i);
+}
+
+#define AVX2_LOOP(intrinsic) \
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, intrinsic(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)))
+
+AVX2 static void op_avx2(VectorOp op, double* y, const double* x, int n) {
+    int i = 0;
+    switch (op) {
+        case VECTOR_ADD: AVX2_LOOP(_mm256_add_pd); break;
+        case VECTOR_SUB: AVX2_LOOP(_mm256_sub_pd); break;
+        case VECTOR_MUL: AVX2_LOOP(_mm256_mul_pd); break;
+        case VECTOR_DIV: AVX2_LOOP(_mm256_div_pd); break;
+    }
+    op_scalar(op, y + i, x + i, n - i);
+}
+
+#define AVX2_INT_LOOP(intrinsic) \
+    for (; i + 8 <= n; i += 8) { \
+        __m256i vy = _mm256_loadu_si256((const __m256i*)(y + i)); \
+        __m256i vx = _mm256_loadu_si256((const __m256i*)(x + i)); \
+        _mm256_storeu_si256((__m256i*)(y + i), intrinsic(vy, vx)); \
+    }
+
+AVX2 static void op_int_avx2(VectorOp op, int32_t* y, const int32_t* x, int n) {
+    int i = 0;
+    switch (op) {
+        case VECTOR_ADD: AVX2_INT_LOOP(_mm256_add_epi32); break;
+        case VECTOR_SUB: AVX2_INT_LOOP(_mm256_sub_epi32); break;
+        case VECTOR_MUL: AVX2_INT_LOOP(_mm256_mullo_epi32); break;
+        case VECTOR_DIV: break;
+    }
+    op_int_scalar(op, y + i, x + i, n - i);
+}
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+static struct {
+    double (*sum)(const double*, int);
+    double (*dot)(const double*, const double*, int);
+    void (*axpy)(double, const double*, double*, int);
+    void (*scale)(double, double*, int);
+    void (*op)(VectorOp, double*, const double*, int);
+    void (*op_int)(VectorOp, int32_t*, const int32_t*, int);
+} kernels;
+
+//Called once by the main VM before any script runs, so parallel workers and matmul threads
+//only ever read the table
+void select_vector_kernels(void) {
+    kernels.sum = sum_scalar;
+    kernels.dot = dot_scalar;
+    kernels.axpy = axpy_scalar;
+    kernels.scale = scale_scalar;
+    kernels.op = op_scalar;
+    kernels.op_int = op_int_scalar;
+
+#if defined(VECTOR_X86) && defined(__SSE2__)
+    kernels.sum = sum_sse2;
+    kernels.dot = dot_sse2;
+    kernels.axpy = axpy_sse2;
+    kernels.scale = scale_sse2;
+    kernels.op = op_sse2;
+#endif
+
+#ifdef VECTOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.sum = sum_avx2;
+        kernels.dot = dot_avx2;
+        kernels.axpy = axpy_avx2;
+        kernels.scale = scale_avx2;
+        kernels.op = op_avx2;
+        kernels.op_int = op_int_avx2;
+    }
+#endif
+}
+
+#define KERNEL(name) (kernels.name)
+
+double vector_sum(const double* x, int n) {
+    return KERNEL(sum)(x, n);
+}
+
+double vector_dot(const double* x, const double* y, int n) {
+    return KERNEL(dot)(x, y, n);
+}
+
+void vector_axpy(double a, const double* x, double* y, int n) {
+    KERNEL(axpy)(a, x, y, n);
+}
+
+void vector_scale(double a, double* x, int n) {
+    KERNEL(scale)(a, x, n);
+}
+
+void vector_op(VectorOp op, double* y, const double* x, int n) {
+    KERNEL(op)(op, y, x, n);
+}
+
+double vector_min(const double* x, int n) {
+    double min = x[0];
+    for (int i = 1; i < n; i++) {
+        if (x[i] < min) min = x[i];
+    }
+    return min;
+}
+
+double vector_max(const double* x, int n) {
+    return x[vector_argmax(x, n)];
+}
+
+int vector_argmax(const double* x, int n) {
+    int idx = 0;
+    for (int i = 1; i < n; i++) {
+        if (x[i] > x[idx]) idx = i;
+    }
+    return idx;
+}
+
+int64_t vector_sum_int(const int32_t* x, int n) {
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++) sum += x[i];
+    return sum;
+}
+
+int64_t vector_dot_int(const int32_t* x, const int32_t* y, int n) {
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++) sum += (int64_t)x[i] * y[i];
+    return sum;
+}
+
+//returns false on division by zero (and leaves 'y' unmodified)
+bool vector_op_int(VectorOp op, int32_t* y, const int32_t* x, int n) {
+    if (op == VECTOR_DIV) {
+        for (int i = 0; i < n; i++) {
+            if (x[i] == 0) return false;
+        }
+    }
+    KERNEL(op_int)(op, y, x, n);
+    return true;
+}
+
+int32_t vector_min_int(const int32_t* x, int n) {
+    int32_t min = x[0];
+    for (int i = 1; i < n; i++) {
+        if (x[i] < min) min = x[i];
+    }
+    return min;
+}
+
+int32_t vector_max_int(const int32_t* x, int n) {
+    return x[vector_argmax_int(x, n)];
+}
+
+int vector_argmax_int(const int32_t* x, int n) {
+    int idx = 0;
+    for (int i = 1; i < n; i++) {
+        if (x[i] > x[idx]) idx = i;
+    }
+    return idx;
+}
+
+/*
+ * Matrix multiplication
+ */
+
+//a block of b (MATMUL_BLOCK_K x MATMUL_BLOCK_N doubles) stays in cache while it is used by every row
+#define MATMUL_BLOCK_K 128
+#define MATMUL_BLOCK_N 256
+//multiplications with fewer multiply-adds than this aren't worth starting threads for
+#define MATMUL_THREAD_MIN_WORK (1 << 20)
+#define MATMUL_MAX_THREADS 16
+
+struct MatmulRows {
+    const double* a;
+    const double* b;
+    double* c;
+    int k;
+    int n;
+    int row_start;
+    int row_end;
+};
+
+static void multiply_rows(struct MatmulRows* rows) {
+    int k = rows->k;
+    int n = rows->n;
+    for (int k0 = 0; k0 < k; k0 += MATMUL_BLOCK_K) {
+        int k1 = k0 + MATMUL_BLOCK_K < k ? k0 + MATMUL_BLOCK_K : k;
+        for (int j0 = 0; j0 < n; j0 += MATMUL_BLOCK_N) {
+            int width = j0 + MATMUL_BLOCK_N < n ? MATMUL_BLOCK_N : n - j0;
+            for (int i = rows->row_start; i < rows->row_end; i++) {
+                double* c_row = rows->c + (size_t)i * n + j0;
+                const double* a_row = rows->a + (size_t)i * k;
+                for (int kk = k0; kk < k1; kk++) {
+                    vector_axpy(a_row[kk], rows->b + (size_t)kk * n + j0, c_row, width);
+                }
+            }
+        }
+    }
+}
+
+#ifdef THREADED_MATMUL
+static void* multiply_rows_thread(void* rows) {
+    multiply_rows((struct MatmulRows*)rows);
+    return NULL;
+}
+#endif
+
+//c (m x n) += a (m x k) * b (k x n), all row-major and contiguous
+void matrix_multiply(const double* a, const double* b, double* c, int m, int k, int n) {
+    int thread_count = 1;
+#ifdef THREADED_MATMUL
+    if ((double)m * k * n >= MATMUL_THREAD_MIN_WORK) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus < 1 ? 1 : (cpus > MATMUL_MAX_THREADS ? MATMUL_MAX_THREADS : (int)cpus);
+        if (thread_count > m) thread_count = m;
+    }
+#endif
+
+    struct MatmulRows rows[MATMUL_MAX_THREADS];
+    for (int t = 0; t < thread_count; t++) {
+        rows[t].a = a;
+        rows[t].b = b;
+        rows[t].c = c;
+        rows[t].k = k;
+        rows[t].n = n;
+        rows[t].row_start = (int)((long)m * t / thread_count);
+        rows[t].row_end = (int)((long)m * (t + 1) / thread_count);
+    }
+
+#ifdef THREADED_MATMUL
+    //the calling thread takes the first rows - rows of threads that fail to start are done here too
+    pthread_t threads[MATMUL_MAX_THREADS];
+    bool started[MATMUL_MAX_THREADS];
+    for (int t = 1; t < thread_count; t++) {
+        started[t] = pthread_create(&threads[t], NULL, multiply_rows_thread, &rows[t]) == 0;
+    }
+    multiply_rows(&rows[0]);
+    for (int t = 1; t < thread_count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            multiply_rows(&rows[t]);
+        }
+    }
+#else
+    multiply_rows(&rows[0]);
+#endif
+}
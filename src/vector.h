@@ -0,0 +1,38 @@
+#ifndef CEBRA_VECTOR_H
+#define CEBRA_VECTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Bulk kernels over the packed elements of List<float>, List<int> and Tensor<float>.  On x86
+//the float kernels use AVX2 when the cpu supports it (checked once at startup) and SSE2
+//otherwise - every other platform gets the scalar versions.
+
+typedef enum {
+    VECTOR_ADD,
+    VECTOR_SUB,
+    VECTOR_MUL,
+    VECTOR_DIV
+} VectorOp;
+
+void select_vector_kernels(void);
+
+double vector_sum(const double* x, int n);
+double vector_dot(const double* x, const double* y, int n);
+void vector_axpy(double a, const double* x, double* y, int n);
+void vector_scale(double a, double* x, int n);
+void vector_op(VectorOp op, double* y, const double* x, int n);
+double vector_min(const double* x, int n);
+double vector_max(const double* x, int n);
+int vector_argmax(const double* x, int n);
+
+int64_t vector_sum_int(const int32_t* x, int n);
+int64_t vector_dot_int(const int32_t* x, const int32_t* y, int n);
+bool vector_op_int(VectorOp op, int32_t* y, const int32_t* x, int n);
+int32_t vector_min_int(const int32_t* x, int n);
+int32_t vector_max_int(const int32_t* x, int n);
+int vector_argmax_int(const int32_t* x, int n);
+
+void matrix_multiply(const double* a, const double* b, double* c, int m, int k, int n);
+
+#endif// CEBRA_VECTOR_H
@@ -2,11 +2,14 @@
 #include "common.h"
 #include "memory.h"
 #include "obj.h"
+#include "vector.h"
 
 
 #define READ_TYPE(frame, type) \
     (frame->ip += (int)sizeof(type), (type)frame->function->chunk.codes[frame->ip - (int)sizeof(type)])
 
+THREAD_LOCAL const char* native_error = NULL;
+
 static void add_error(VM* vm, const char* message) {
     struct Error error;
     error.message = message;
@@ -41,6 +44,7 @@ static Value peek(VM* vm, int depth) {
 
 ResultCode init_vm(VM* vm) {
     vm->initialized = false;
+    select_vector_kernels();
 
     vm->stack_top = &vm->stack[0];
     vm->frame_count = 0;
@@ -53,9 +57,50 @@ ResultCode init_vm(VM* vm) {
     vm->error_count = 0;
     init_table(&vm->globals);
     init_table(&vm->strings);
+    for (int i = 0; i < 256; i++) {
+        vm->single_chars[i] = NULL;
+    }
+
+    vm->initialized = true;
+
+    //after 'initialized' so the GC treats the ones already made as roots
+    for (int i = 0; i < 256; i++) {
+        char c = (char)i;
+        vm->single_chars[i] = make_string(&c, 1);
+    }
+
+    return RESULT_SUCCESS;
+}
+
+//Worker VMs (see parallel.c) read the globals and one character strings of 'parent'
+//and never intern strings of their own.  The worker heap must use 'vm' as its VM.
+ResultCode init_worker_vm(VM* vm, VM* parent) {
+    vm->initialized = false;
+
+    vm->stack_top = &vm->stack[0];
+    vm->frame_count = 0;
+    vm->open_upvalues = NULL;
+    vm->errors = (struct Error*)malloc(MAX_ERRORS * sizeof(struct Error));
+    if (vm->errors == NULL) {
+        fprintf(stderr, "malloc");
+        exit(1);
+    }
+    vm->error_count = 0;
+    vm->globals = parent->globals;
+    init_table(&vm->strings);
+    for (int i = 0; i < 256; i++) {
+        vm->single_chars[i] = parent->single_chars[i];
+    }
 
     vm->initialized = true;
+    return RESULT_SUCCESS;
+}
 
+//the globals belong to the parent VM
+ResultCode free_worker_vm(VM* vm) {
+    free_table(&vm->strings);
+    free(vm->errors);
+    pop_stack(vm);
     return RESULT_SUCCESS;
 }
 
@@ -82,6 +127,43 @@ void call(VM* vm, struct ObjFunction* function) {
     vm->frame_count++;
 }
 
+//[native][args...] -> [returns...]
+static ResultCode call_native(VM* vm, int arity) {
+    ResultCode (*native)(Value*, struct ValueArray*) = peek(vm, arity).as.native_type->function;
+
+    //natives read 'chars' directly, so hand them flat strings
+    Value* args = vm->stack_top - arity;
+    for (int i = 0; i < arity; i++) {
+        if (args[i].type == VAL_STRING) {
+            args[i].as.string_type = materialize_string(args[i].as.string_type);
+        }
+        //files and string builders are modified by natives that only read other objects
+        if ((args[i].type == VAL_FILE || args[i].type == VAL_STRING_BUILDER) && IS_FOREIGN(get_object(&args[i]))) {
+            add_error(vm, "Files and string builders can't be used by parallel workers.");
+            return RESULT_FAILED;
+        }
+    }
+
+    //setting size to before calling native function so that 
+    struct ValueArray va;
+    init_value_array(&va);
+    native_error = NULL;
+    ResultCode result = native(vm->stack_top - arity, &va);
+    if (result == RESULT_FAILED) {
+        free_value_array(&va);
+        add_error(vm, native_error != NULL ? native_error : "Native function failed.");
+        return RESULT_FAILED;
+    }
+    for (int i = 0; i < arity + 1; i++) {
+        pop(vm);
+    }
+    for (int i = 0; i < va.count; i++) {
+        push(vm, va.values[i]);
+    }
+    free_value_array(&va);
+    return RESULT_SUCCESS;
+}
+
 static Value read_constant(CallFrame* frame, int idx) {
     return frame->function->chunk.constants.values[idx];
 }
@@ -164,6 +246,10 @@ ResultCode run_program(VM* vm) {
                 push(vm, read_constant(frame, READ_TYPE(frame, uint16_t)));
                 struct ObjFunction* func = peek(vm, 0).as.function_type;
                 int total_upvalues = READ_TYPE(frame, uint8_t);
+                if (total_upvalues > 0 && IS_FOREIGN(func)) {
+                    add_error(vm, "Closures can't be made by parallel workers.");
+                    return RESULT_FAILED;
+                }
                 for (int i = 0; i < total_upvalues; i++) {
                     bool is_local = READ_TYPE(frame, uint8_t);
                     int idx = READ_TYPE(frame, uint8_t);
@@ -186,6 +272,7 @@ ResultCode run_program(VM* vm) {
                     struct ObjStruct* klass = make_struct(struct_string, super_val.as.class_type);
                     push(vm, to_struct(klass));
                     copy_table(&klass->props, &super_val.as.class_type->props);
+                    klass->container_count = super_val.as.class_type->container_count;
                 } else {
                     struct ObjStruct* klass = make_struct(struct_string, NULL);
                     push(vm, to_struct(klass));
@@ -196,16 +283,19 @@ ResultCode run_program(VM* vm) {
                 //current stack: [script]...[class][value]
                 struct ObjString* prop = read_constant(frame, READ_TYPE(frame, uint16_t)).as.string_type;
                 struct ObjStruct* klass = peek(vm, 1).as.class_type;
-                set_entry(&klass->props, prop, peek(vm, 0));
+                Value old;
+                if (get_entry(&klass->props, prop, &old) && copied_per_instance(old)) {
+                    klass->container_count--;
+                }
+                Value value = peek(vm, 0);
+                if (copied_per_instance(value)) klass->container_count++;
+                set_entry(&klass->props, prop, value);
                 break;
             }
             case OP_INSTANCE: {
-                struct ObjStruct* klass = pop(vm).as.class_type;
-                struct Table props;
-                init_table(&props);
-                struct ObjInstance* inst = make_instance(props, klass);
+                struct ObjInstance* inst = make_instance(peek(vm, 0).as.class_type);
+                pop(vm);
                 push(vm, to_instance(inst));
-                copy_table(&inst->props, &klass->props);
                 break;
             }
             case OP_NEGATE: {
@@ -231,18 +321,7 @@ ResultCode run_program(VM* vm) {
                 } else if (b.type == VAL_FLOAT) {
                     result = to_float(a.as.float_type + b.as.float_type);
                 } else if (b.type == VAL_STRING) {
-                    struct ObjString* left = a.as.string_type;
-                    struct ObjString* right = b.as.string_type;
-
-                    int length =  left->length + right->length;
-                    char* concat = ALLOCATE_ARRAY(char);
-                    concat = GROW_ARRAY(concat, char, length + 1, 0);
-                    memcpy(concat, left->chars, left->length);
-                    memcpy(concat + left->length, right->chars, right->length);
-                    concat[length] = '\0';
-
-                    struct ObjString* obj = take_string(concat, length);
-                    result = to_string(obj);
+                    result = to_string(concat_strings(a.as.string_type, b.as.string_type));
                 } else {
                     add_error(vm, "Only ints, floats and strings can be used with the '+' operator.");
                     return RESULT_FAILED;
@@ -333,6 +412,10 @@ ResultCode run_program(VM* vm) {
                 struct ObjInstance* inst = pop(vm).as.instance_type;
                 struct ObjString* prop_name = read_constant(frame, READ_TYPE(frame, uint16_t)).as.string_type;
                 int depth = READ_TYPE(frame, uint8_t);
+                if (IS_FOREIGN(inst)) {
+                    add_error(vm, "Parallel workers can't modify objects they didn't make.");
+                    return RESULT_FAILED;
+                }
                 Value value = peek(vm, depth);
                 set_entry(&inst->props, prop_name, value);
                 break;
@@ -356,6 +439,10 @@ ResultCode run_program(VM* vm) {
             case OP_SET_UPVALUE: {
                 uint8_t slot = READ_TYPE(frame, uint8_t);
                 uint8_t depth = READ_TYPE(frame, uint8_t);
+                if (IS_FOREIGN(frame->function->upvalues[slot])) {
+                    add_error(vm, "Parallel workers can't modify objects they didn't make.");
+                    return RESULT_FAILED;
+                }
                 *frame->function->upvalues[slot]->location = peek(vm, depth);
                 break;
             }
@@ -407,23 +494,7 @@ ResultCode run_program(VM* vm) {
                     call(vm, value.as.function_type);
                     frame = &vm->frames[vm->frame_count - 1];
                 } else if (value.type == VAL_NATIVE) {
-                    ResultCode (*native)(Value*, struct ValueArray*) = value.as.native_type->function;
-
-                    //setting size to before calling native function so that 
-                    struct ValueArray va;
-                    init_value_array(&va);
-                    ResultCode result = native(vm->stack_top - arity, &va);
-                    if (result == RESULT_FAILED) {
-                        add_error(vm, "Native function failed.");
-                        return RESULT_FAILED;
-                    }
-                    for (int i = 0; i < arity + 1; i++) {
-                        pop(vm);
-                    }
-                    for (int i = 0; i < va.count; i++) {
-                        push(vm, va.values[i]);
-                    }
-                    free_value_array(&va);
+                    if (call_native(vm, arity) == RESULT_FAILED) return RESULT_FAILED;
                 }
                 break;
             }
@@ -448,7 +519,7 @@ ResultCode run_program(VM* vm) {
                 break;
             }
             case OP_LIST: {
-                struct ObjList* list = make_list();
+                struct ObjList* list = make_list(READ_TYPE(frame, uint8_t));
                 push(vm, to_list(list));
                 break;
             }
@@ -457,20 +528,31 @@ ResultCode run_program(VM* vm) {
                 push(vm, to_map(map));
                 break;
             }
+            case OP_SET: {
+                struct ObjSet* set = make_set();
+                push(vm, to_set(set));
+                break;
+            }
             case OP_GET_SIZE: {
                 Value value = pop(vm);
                 if (value.type == VAL_LIST) {
                     struct ObjList* list = value.as.list_type;
-                    push(vm, to_integer(list->values.count));
+                    push(vm, to_integer(list->count));
                 }
                 if (value.type == VAL_STRING) {
                     struct ObjString* str = value.as.string_type;
                     push(vm, to_integer(str->length));
                 }
+                if (value.type == VAL_SET) {
+                    push(vm, to_integer(value.as.set_type->table.count));
+                }
+                if (value.type == VAL_BYTES) {
+                    push(vm, to_integer(value.as.bytes_type->length));
+                }
                 break;
             }
             case OP_SLICE: {
-                //[string | List][start idx][end idx - exclusive]
+                //[string | List | Bytes][start idx][end idx - exclusive]
                 int end_idx = pop(vm).as.integer_type;
                 int start_idx = pop(vm).as.integer_type;
                 if (end_idx - start_idx < 0) {
@@ -480,25 +562,28 @@ ResultCode run_program(VM* vm) {
 
                 Value v = peek(vm, 0);
                 if (v.type == VAL_STRING) {
-                    struct ObjString* s = v.as.string_type;
-                    struct ObjString* sub = make_string(s->chars + start_idx, end_idx - start_idx);
+                    struct ObjString* s = flatten_string(v.as.string_type);
+                    struct ObjString* sub = make_string_view(s, start_idx, end_idx - start_idx);
                     pop(vm);
                     push(vm, to_string(sub));
                 } else if (v.type == VAL_LIST) {
-                    struct ObjList* list = make_list();
-                    push(vm, to_list(list));
                     struct ObjList* slice_list = v.as.list_type;
-                    //add elements
-                    if (end_idx > slice_list->values.count || start_idx < 0) {
+                    if (end_idx > slice_list->count || start_idx < 0) {
                         add_error(vm, "Slicing indices must be between 0 and List size (inclusive).");
                         return RESULT_FAILED;
                     }
-                    for (int i = start_idx; i < end_idx; i++) {
-                        add_value(&list->values, slice_list->values.values[i]); 
-                    }
-                    pop(vm); //pop new list so that we can remove the old list
+                    struct ObjList* list = make_list_slice(slice_list, start_idx, end_idx);
                     pop(vm);
                     push(vm, to_list(list));
+                } else if (v.type == VAL_BYTES) {
+                    struct ObjBytes* bytes = v.as.bytes_type;
+                    if (end_idx > bytes->length || start_idx < 0) {
+                        add_error(vm, "Slicing indices must be between 0 and Bytes size (inclusive).");
+                        return RESULT_FAILED;
+                    }
+                    struct ObjBytes* slice = make_bytes_slice(bytes, start_idx, end_idx);
+                    pop(vm);
+                    push(vm, to_bytes(slice));
                 }
 
                 /*
@@ -515,7 +600,7 @@ ResultCode run_program(VM* vm) {
                 break;
             }
             case OP_GET_ELEMENT: {
-                //[list | map | string][idx]
+                //[list | map | string | Bytes][idx]
                 Value left = peek(vm, 1);
                 if (left.type == VAL_STRING) {
                     int idx = pop(vm).as.integer_type;
@@ -524,25 +609,43 @@ ResultCode run_program(VM* vm) {
                         add_error(vm, "Index out of bounds.");
                         return RESULT_FAILED;
                     }
+                    str = flatten_string(str);
                     pop(vm);
-                    struct ObjString* c = make_string(str->chars + idx, 1);
+                    struct ObjString* c = vm->single_chars[(uint8_t)STRING_CHARS(str)[idx]];
                     push(vm, to_string(c));
                     break; 
                 } else if (left.type == VAL_LIST) {
                     int idx = pop(vm).as.integer_type;
                     struct ObjList* list = left.as.list_type;
-                    if (idx >= list->values.count) {
+                    if (idx >= list->count) {
+                        add_error(vm, "Index out of bounds.");
+                        return RESULT_FAILED;
+                    }
+                    pop(vm);
+                    switch (list->kind) {
+                        case LIST_INT: push(vm, to_integer(LIST_DATA(list, int32_t)[idx])); break;
+                        case LIST_FLOAT: push(vm, to_float(LIST_DATA(list, double)[idx])); break;
+                        case LIST_BYTE: push(vm, to_byte(LIST_DATA(list, uint8_t)[idx])); break;
+                        default: push(vm, LIST_VALUES(list)[idx]); break;
+                    }
+                    break;
+                } else if (left.type == VAL_BYTES) {
+                    int idx = pop(vm).as.integer_type;
+                    struct ObjBytes* bytes = left.as.bytes_type;
+                    if (idx < 0 || idx >= bytes->length) {
                         add_error(vm, "Index out of bounds.");
                         return RESULT_FAILED;
                     }
                     pop(vm);
-                    push(vm, list->values.values[idx]);
+                    push(vm, to_byte(bytes->data[idx]));
                     break;
                 } else if (left.type == VAL_MAP) {
-                    struct ObjString* key = pop(vm).as.string_type;
+                    Value key = peek(vm, 0);
+                    if (key.type == VAL_STRING) key = to_string(flatten_string(key.as.string_type));
+                    pop(vm);
                     struct ObjMap* map = left.as.map_type;
                     Value value = to_nil();
-                    get_entry(&map->table, key, &value);
+                    get_value_entry(MAP_TABLE(map), key, &value);
                     pop(vm);
                     push(vm, value);
                     break;
@@ -555,30 +658,40 @@ ResultCode run_program(VM* vm) {
                 //[value][list | map | string][idx]
                 Value left = peek(vm, 1);
                 Value value = peek(vm, READ_TYPE(frame, uint8_t) + 2);
+                struct Obj* target = get_object(&left);
+                if (target != NULL && IS_FOREIGN(target)) {
+                    add_error(vm, "Parallel workers can't modify objects they didn't make.");
+                    return RESULT_FAILED;
+                }
                 if (left.type == VAL_STRING) {
-                    struct ObjString* str = left.as.string_type;
+                    struct ObjString* str = materialize_string(left.as.string_type);
                     int idx = peek(vm, 0).as.integer_type;
                     if (value.as.string_type->length > 1) {
                         add_error(vm, "Character at index can only be set to single character string.");
                     }
 
-                    str->chars[idx] = *(value.as.string_type->chars);
+                    str->chars[idx] = *STRING_CHARS(flatten_string(value.as.string_type));
+                    if (!str->is_interned) str->is_hashed = false;
                 }
                 if (left.type == VAL_LIST) {
                     struct ObjList* list = left.as.list_type;
                     int idx = peek(vm, 0).as.integer_type;
-                    if (idx == list->values.count) {
-                        add_value(&list->values, value);
-                    } else if (idx < list->values.count) {
-                        list->values.values[idx] = value;
+                    if (idx == list->count) {
+                        list_append(list, value);
+                    } else if (idx < list->count) {
+                        list_set(list, idx, value);
                     } else {
                         add_error(vm, "Can only set List elements using an index equal or less than List size.");
                     }
                 }
                 if (left.type == VAL_MAP) {
                     struct ObjMap* map = left.as.map_type;
-                    struct ObjString* key = peek(vm, 0).as.string_type;
-                    set_entry(&map->table, key, value);
+                    Value key = peek(vm, 0);
+                    if (key.type == VAL_STRING) key = to_string(intern_in_place(key.as.string_type));
+                    push_root(key);
+                    materialize_map(map);
+                    set_value_entry(&map->table, key, value);
+                    pop_root();
                 }
                 pop(vm);
                 pop(vm);
@@ -589,8 +702,8 @@ ResultCode run_program(VM* vm) {
                 struct ObjList* list = peek(vm, 0).as.list_type;
                 Value value = peek(vm, 1);
                 bool in_list = false;
-                for (int i = 0; i < list->values.count; i++) {
-                    if (equal_values(value, list->values.values[i]).as.boolean_type) {
+                for (int i = 0; i < list->count; i++) {
+                    if (equal_values(value, list_get(list, i)).as.boolean_type) {
                         in_list = true;
                         break;
                     }                
@@ -600,30 +713,62 @@ ResultCode run_program(VM* vm) {
                 push(vm, to_boolean(in_list));
                 break;
             }
+            case OP_IN_SET: {
+                //[value][set]
+                struct ObjSet* set = peek(vm, 0).as.set_type;
+                Value value = peek(vm, 1);
+                if (value.type == VAL_STRING) value = to_string(flatten_string(value.as.string_type));
+                Value unused;
+                bool in_set = get_value_entry(&set->table, value, &unused);
+                pop(vm);
+                pop(vm);
+                push(vm, to_boolean(in_set));
+                break;
+            }
             case OP_GET_KEYS: {
                 struct ObjMap* map = pop(vm).as.map_type;
-                struct ObjList* list = make_list();
+                struct ObjList* list = make_list(READ_TYPE(frame, uint8_t));
                 push(vm, to_list(list));
-                for (int i = 0; i < map->table.capacity; i++) {
-                    struct Entry* entry = &map->table.entries[i];
-                    if (entry->key != NULL) {
-                        add_value(&list->values, to_string(entry->key));
+                struct ValueTable* table = MAP_TABLE(map);
+                for (int i = 0; i < table->entry_count; i++) {
+                    struct ValueEntry* entry = &table->entries[i];
+                    if (entry->key.type != VAL_NIL) {
+                        list_append(list, entry->key);
                     }
                 }
                 break;
             }
             case OP_GET_VALUES: {
                 struct ObjMap* map = pop(vm).as.map_type;
-                struct ObjList* list = make_list();
+                struct ObjList* list = make_list(READ_TYPE(frame, uint8_t));
                 push(vm, to_list(list));
-                for (int i = 0; i < map->table.capacity; i++) {
-                    struct Entry* entry = &map->table.entries[i];
-                    if (entry->key != NULL) {
-                        add_value(&list->values, entry->value);
+                struct ValueTable* table = MAP_TABLE(map);
+                for (int i = 0; i < table->entry_count; i++) {
+                    struct ValueEntry* entry = &table->entries[i];
+                    if (entry->key.type != VAL_NIL) {
+                        list_append(list, entry->value);
                     }
                 }
                 break;
             }
+            case OP_NEXT_ENTRY: {
+                //the map (or set) and the index of the next entry to look at are in locals
+                uint8_t map_slot = READ_TYPE(frame, uint8_t);
+                uint8_t cursor_slot = READ_TYPE(frame, uint8_t);
+                uint8_t values = READ_TYPE(frame, uint8_t);
+                uint16_t distance = READ_TYPE(frame, uint16_t);
+                Value iterable = frame->locals[map_slot];
+                struct ValueTable* table = iterable.type == VAL_SET ? &iterable.as.set_type->table : MAP_TABLE(iterable.as.map_type);
+                int i = frame->locals[cursor_slot].as.integer_type;
+                while (i < table->entry_count && table->entries[i].key.type == VAL_NIL) i++;
+                if (i >= table->entry_count) {
+                    frame->ip += distance;
+                    break;
+                }
+                frame->locals[cursor_slot] = to_integer(i + 1);
+                push(vm, values ? table->entries[i].value : table->entries[i].key);
+                break;
+            }
             case OP_CAST: {
                 uint16_t to_type = READ_TYPE(frame, uint16_t);
                 Value value = peek(vm, 0);
@@ -705,25 +850,29 @@ ResultCode run_program(VM* vm) {
             case OP_CONCAT: {
                 int unwrap_left = READ_TYPE(frame, uint8_t);
                 int unwrap_right = READ_TYPE(frame, uint8_t);
+                ListKind kind = READ_TYPE(frame, uint8_t);
                 Value right = peek(vm, 0);
                 Value left = peek(vm, 1);
-                struct ObjList* list = make_list();
+                struct ObjList* list = make_list(kind);
                 push(vm, to_list(list));
+                int left_count = unwrap_left ? left.as.list_type->count : 1;
+                int right_count = unwrap_right ? right.as.list_type->count : 1;
+                reserve_list(list, left_count + right_count);
                 if (unwrap_left) {
                     struct ObjList* left_list = left.as.list_type;
-                    for (int i = 0; i < left_list->values.count; i++) {
-                        add_value(&list->values, left_list->values.values[i]);
+                    for (int i = 0; i < left_list->count; i++) {
+                        list_append(list, list_get(left_list, i));
                     }
                 } else {
-                    add_value(&list->values, left);
+                    list_append(list, left);
                 }
                 if (unwrap_right) {
                     struct ObjList* right_list = right.as.list_type;
-                    for (int i = 0; i < right_list->values.count; i++) {
-                        add_value(&list->values, right_list->values.values[i]);
+                    for (int i = 0; i < right_list->count; i++) {
+                        list_append(list, list_get(right_list, i));
                     }
                 } else {
-                    add_value(&list->values, right);
+                    list_append(list, right);
                 }
                 pop(vm);
                 pop(vm);
@@ -741,6 +890,17 @@ ResultCode run_program(VM* vm) {
     return RESULT_SUCCESS;
 }
 
+//Calls the function or native below the top 'arity' values on the stack and runs it to
+//completion, leaving its return values in its place.  Only for VMs that aren't
+//already running (eg, worker VMs - see parallel.c).
+ResultCode call_value(VM* vm, int arity) {
+    Value value = peek(vm, arity);
+    if (value.type == VAL_NATIVE) return call_native(vm, arity);
+
+    call(vm, value.as.function_type);
+    return run_program(vm);
+}
+
 ResultCode run(VM* vm, struct ObjFunction* script) {
     //first time script is run
     if (vm->stack == vm->stack_top) {
@@ -26,11 +26,18 @@ typedef struct {
     int error_count;
     struct Table globals;
     struct Table strings;
+    struct ObjString* single_chars[256]; //interned one character strings for string indexing
     bool initialized;
 } VM;
 
+//natives can set this before failing to report something more specific than "Native function failed."
+extern THREAD_LOCAL const char* native_error;
+
 ResultCode init_vm(VM* vm);
 ResultCode free_vm(VM* vm);
+ResultCode init_worker_vm(VM* vm, VM* parent);
+ResultCode free_worker_vm(VM* vm);
+ResultCode call_value(VM* vm, int arity);
 ResultCode run(VM* vm, struct ObjFunction* script);
 Value pop(VM* vm);
 void pop_stack(VM* vm);